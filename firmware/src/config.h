@@ -2,12 +2,43 @@
 
 // --- Serial ---
 #define USB_BAUD_RATE 1000000UL
+// Power-on rate of the GM counter link.  Newer tube electronics boards accept
+// higher rates (selectable on the board); the link has no acknowledgements, so
+// the firmware cannot probe — SYST:BAUD re-opens Serial1 at an operator-chosen
+// rate instead.
 #define GM_BAUD_RATE 9600
 
+// --- Serial1 TX queue ---------------------------------------------------------
+// Every one-letter GM counter line goes through a small FIFO drained by
+// scpiSerial1Service(), which only hands a line to the UART when the whole
+// line fits in the hardware TX buffer.  A direct println() of a 5-char line
+// otherwise blocks for ~6 ms at 9600 baud — during streaming that delays the
+// next gmProcessAcquisition() pass and shows up as ring-occupancy spikes.
+// Depth 8 covers the worst burst (*RST while streaming: two stop lines plus
+// four re-applied defaults).
+#define S1TX_QUEUE_SIZE 8
+#define S1TX_MSG_LEN 12 // longest line is "j<voltage>" — 4 chars + terminator
+
 // --- Hardware ---
 #define INTERRUPT_PIN 2
 #define DEBOUNCE_US 10UL
 
+// --- Second capture channel (CONF:CH2) -------------------------------------------
+// Opt-in second detector input on D3, timestamped by gmISR2() against the same
+// 48 MHz timebase as channel 1 — the prerequisite for coincidence windows and
+// the two-source dead-time method without a second board.  Channel-2 data
+// frames use marker 0xA9 with the identical fixed layout [0xA9, delta LE32,
+// 0x55].  While CH2 is enabled BOTH channels seed their delta baseline from
+// the stream-start tick instead of their own first event, so the host can
+// reconstruct absolute event times per channel (cumulative delta sums) and
+// correlate them on one timeline.  Only ACQ_STREAM + ENC_FIXED support the
+// channel tag; CONF:CH2 ON is rejected in any other configuration.  Off by
+// default: a host parser that predates the 0xA9 marker would misframe on it.
+#define INTERRUPT2_PIN 3
+#define CH2_MARKER_BYTE 0xA9
+#define RING2_BUF_SIZE 256 // 1 KB — ch2 rates are modest (coincidence partners)
+#define RING2_BUF_MASK (RING2_BUF_SIZE - 1)
+
 // --- High-resolution timing ---------------------------------------------------
 // On the Uno R4 Minima (Renesas RA4M1, Cortex-M4 @ 48 MHz) pulse edges are
 // timestamped with the DWT cycle counter (CYCCNT) instead of micros().  This
@@ -19,10 +50,10 @@
 // and every existing test keeps asserting plain-microsecond deltas unchanged.
 //
 // Define USE_CYCLE_COUNTER on the build command line to override the default.
-// TRADE-OFF: cycle-counter mode wraps every ~89.48 s, so inter-event gaps that
-// long are silently misread (see docs/TIMING_AND_GPT_TIMER.md).  Harmless for
-// dead-time runs and normal background; for ultra-weak sources (mean gap nearing
-// a minute) build with -DUSE_CYCLE_COUNTER=0 to use micros() (~71.6 min wrap).
+// WRAP: the raw counter is 32-bit (~89.48 s at 48 MHz), but gmProcessAcquisition()
+// extends timestamps to 64 bits with a drain-loop wrap epoch, so arbitrarily long
+// gaps are measured correctly in every mode (see docs/TIMING_AND_GPT_TIMER.md).
+// Only the 32-bit wire delta saturates at 2^32 - 1 ticks.
 #ifndef USE_CYCLE_COUNTER
 #if defined(ARDUINO_ARCH_RENESAS)
 #define USE_CYCLE_COUNTER 1
@@ -31,7 +62,27 @@
 #endif
 #endif
 
-#if USE_CYCLE_COUNTER
+// --- GPT hardware input capture (experimental) ---------------------------------
+// Approach C from docs/TIMING_AND_GPT_TIMER.md: a 32-bit GPT channel latches its
+// counter in hardware at the pulse edge, so the ~1–2 µs of variable ISR-entry
+// latency no longer shifts the timestamp — gmISR() just reads the already-latched
+// capture register.  The GPT runs from PCLKD/1 (48 MHz), so TICKS_PER_US and the
+// ~89.48 s wrap limit are identical to cycle-counter mode and the host needs no
+// changes.
+//
+// Opt-in (-DUSE_GPT_CAPTURE=1) because it programs RA4M1 registers underneath the
+// Arduino core: it claims GPT channel 1 (GPT321, which drives PWM on some pins)
+// and muxes D2/P105 to its GTIOC1A input.  Validated on hardware only — the
+// native test environment has no GPT to mock, so tests always build with this off.
+#ifndef USE_GPT_CAPTURE
+#define USE_GPT_CAPTURE 0
+#endif
+
+#if USE_GPT_CAPTURE && !defined(ARDUINO_ARCH_RENESAS)
+#error "USE_GPT_CAPTURE=1 requires the RA4M1 target (ARDUINO_ARCH_RENESAS)"
+#endif
+
+#if USE_CYCLE_COUNTER || USE_GPT_CAPTURE
 #define TICKS_PER_US 48UL // RA4M1 core clock = 48 MHz  (== host ticks_per_us)
 #else
 #define TICKS_PER_US 1UL // micros() fallback (native tests)
@@ -42,17 +93,241 @@
 
 // --- USB TX batching ----------------------------------------------------------
 // TX_BATCH_PACKETS: number of 6-byte packets coalesced before a flush attempt.
-// TX_BUF_PACKETS:   total _txBuf capacity — must be > TX_BATCH_PACKETS to absorb
-//                   residue left over when a partial non-blocking flush can only
-//                   send part of the batch (host USB buffer temporarily full).
+// TX_BUF_PACKETS:   capacity of each of the two ping-pong TX halves.  The
+//                   builder fills one half while the other drains, so a
+//                   partial non-blocking flush leaves its residue in place
+//                   (no copying) and packet building continues in the other
+//                   half; total buffering is 2 × TX_BUF_PACKETS packets.
 //
 // txFlush() is non-blocking: it writes only what Serial.availableForWrite()
-// can accept without stalling.  Leftover bytes stay in _txBuf for the next
-// drain cycle.  This ensures gmProcessAcquisition() is never blocked by USB
-// back-pressure, which would stall ring-buffer draining and cause artificial
-// large inter-event deltas when the ring buffer subsequently overflows.
+// can accept without stalling.  Leftover bytes stay in the drain half for the
+// next drain cycle.  This ensures gmProcessAcquisition() is never blocked by
+// USB back-pressure, which would stall ring-buffer draining and cause
+// artificial large inter-event deltas when the ring buffer subsequently
+// overflows.
+// TX_FLUSH_DEADLINE_MS: upper bound on how long a partial batch may be held.
+// A full batch still flushes immediately, so high-rate coalescing is
+// unchanged; below-batch traffic flushes at the deadline instead of on every
+// drain pass.  At background rates (~1 count/s) this bounds the live-display
+// latency to the deadline, while at moderate rates (kHz) packets coalesce for
+// a full deadline window instead of going out one USB write per event.
 #define TX_BATCH_PACKETS 32
-#define TX_BUF_PACKETS 64 // 2× batch — headroom for partial-flush residue
+#define TX_BUF_PACKETS 64 // per ping-pong half — 2× batch of headroom each
+#define TX_FLUSH_DEADLINE_MS 20UL
+
+// --- Stream encoding (CONF:ENC) ------------------------------------------------
+// ENC_FIXED:  classic [0xAA, delta LE32, 0x55] 6-byte frames.
+// ENC_VARINT: LEB128 varint deltas (7 data bits per byte, MSB = continuation).
+//             At high rates a delta fits in 2–3 bytes, roughly halving USB
+//             bandwidth versus the fixed frame — the link, not the ISR, is the
+//             bottleneck at our top rates (see acqStats.txDrops).
+//
+// Resync: a LEB128 stream can contain at most 4 consecutive MSB-set bytes (a
+// 32-bit varint has ≤ 4 continuation bytes and every final byte is < 0x80), so
+// a run of five 0xFF bytes can never occur in data.  One such run is emitted
+// every VARINT_RESYNC_INTERVAL deltas; a host that loses bytes re-locks at the
+// next marker.  The 6 × 0xFF start and 6 × 0xEE end markers stay unambiguous
+// for the same reason.
+// ENC_SEQ:    8-byte frames [0xAA, seq(u8), delta LE32, crc8, 0x55].  seq is a
+//             rolling counter that increments for every produced packet —
+//             INCLUDING packets dropped by TX back-pressure — so the host can
+//             detect and localize loss in-line instead of discarding a whole
+//             run when acqStats.txDrops is nonzero.  crc8 (poly 0x07, init 0)
+//             covers seq + payload and catches corrupted frames cheaply.
+#define ENC_FIXED 0
+#define ENC_VARINT 1
+#define ENC_SEQ 2
+#define SEQ_FRAME_LEN 8
+#define VARINT_RESYNC_BYTE 0xFF
+#define VARINT_RESYNC_LEN 5
+#define VARINT_RESYNC_INTERVAL 64
+
+// --- Acquisition mode (CONF:ACQ) -----------------------------------------------
+// ACQ_STREAM: classic per-event delta streaming (the default).
+// ACQ_HIST:   bin every delta into an on-device histogram and stream the bin
+//             array once per second instead of per-event packets.  The
+//             measurable pulse rate is then decoupled from the USB link — only
+//             the ISR limits it — which is what dead-time curve fitting needs
+//             (it only uses the inter-arrival distribution, never raw events).
+//
+// Histogram frame: [0xAC, nbins(u8), nbins × bin count LE32, 0x55].  Counts are
+// cumulative since INIT and saturate at 0xFFFFFFFF, so a lost frame costs
+// nothing — the next snapshot supersedes it.
+//
+// Binning (CONF:HIST): LOG (default) uses 32 log2-spaced bins of the tick
+// delta — bin = floor(log2(delta)) — covering the full 32-bit range with
+// constant relative resolution.  LIN,<width_us> uses 64 linear bins of the
+// given width; out-of-range deltas land in the last bin.
+// ACQ_BURST (CONF:ACQ BURST[,n]): loss-free capture of short intense bursts
+// (pulser calibration, strong-source close-ups).  The drain loop copies deltas
+// into a large SRAM capture array with zero TX activity; once the target count
+// is reached the array streams out in the configured encoding, followed by the
+// 0xEE end marker.  The acquisition ceiling is then the ISR, not the USB link.
+//
+// BURST_BUF_SIZE: 4096 × 4 B = 16 KB of the RA4M1's spare SRAM (the ring takes
+// 4 KB; the remainder leaves headroom for the stack and the Arduino core).
+//
+// ACQ_MCS (CONF:ACQ MCS,<width_us>): multichannel-scaler counting.  The drain
+// loop accumulates a count per fixed-width time bin and emits one compact
+// frame per bin boundary — [0xAE, bin_idx LE16, count LE32, 0x55] — instead of
+// per-event packets, so USB traffic is set by the bin width, not the pulse
+// rate, and a bin count can never be lost to txDrops back-pressure.  Empty
+// bins emit too (the host's interval plot needs them); the trailing partial
+// bin at stop is discarded, as only complete bins are comparable.  bin_idx
+// wraps at 2^16 on very long runs.
+#define ACQ_STREAM 0
+#define ACQ_HIST 1
+#define ACQ_BURST 2
+#define ACQ_MCS 3
+#define ACQ_RNG 4
+#define BURST_BUF_SIZE 4096
+#define MCS_MARKER_BYTE 0xAE
+#define MCS_FRAME_LEN 8
+#define DEFAULT_MCS_WIDTH_US 1000000UL // 1 s bins until CONF:ACQ MCS,<width_us>
+// Widths above 60 s would risk _mcsWidthTicks overflowing 32 bits at 48 MHz.
+#define MCS_WIDTH_MAX_US 60000000UL
+// --- RNG entropy extraction (ACQ_RNG) ----------------------------------------
+// Streams packed entropy bytes instead of timing packets.  Each accepted
+// delta contributes its least-significant tick bit (at 48 MHz the LSB flips
+// on a ~20.8 ns scale — far below any systematic in the tube), and a debiaser
+// turns the harvested bits into output bits:
+//   RNG_VN     — von Neumann: successive bit pairs, 01→0, 10→1, 00/11
+//                discarded.  Provably unbiased for independent bits at the
+//                cost of ≥ 75 % of the raw bits.
+//   RNG_PARITY — parity of the delta's low 8 bits: 1 output bit per event;
+//                XOR-folding shrinks residual bias exponentially but does not
+//                null it.
+// Output frame: [0xAF, 16 entropy bytes, 0x55].  A 6-byte timing packet
+// yields 32 delta bits of which ~1 is usable entropy, so on-device
+// extraction multiplies usable random-bit throughput per USB byte by ~40 and
+// lets several boards share one host port budget.
+#define RNG_MARKER_BYTE 0xAF
+#define RNG_PAYLOAD_BYTES 16
+#define RNG_FRAME_LEN (RNG_PAYLOAD_BYTES + 2)
+#define RNG_VN 0
+#define RNG_PARITY 1
+#define DEFAULT_RNG_METHOD RNG_VN
+
+#define HIST_MARKER_BYTE 0xAC
+#define HIST_LOG_BINS 32
+#define HIST_LIN_BINS 64
+#define HIST_EMIT_INTERVAL_MS 1000UL
+
+// --- Live stats sideband (CONF:STATS) --------------------------------------------
+// Opt-in 0xAB-framed telemetry emitted by the drain loop once per second while
+// streaming: [0xAB, nPoints LE32, overflows LE32, txDrops LE32, debounced LE32,
+// ringFillPeak LE16, subDead LE16, nearDead LE16, 0x55] (the two dead-time
+// counters saturate at 65535; see CONF:DEAD below).  DIAG:STAT? is text-only and
+// therefore unreadable until a run ends; the sideband lets the host raise a
+// back-pressure alarm while there is still time to save the session.
+//
+// ringFillPeak is the deepest ring backlog observed at drain start since the
+// previous frame — the earliest warning that the consumer is falling behind.
+// The frame is 24 bytes, a multiple of both fixed frame sizes (6 and 8), so
+// packet-aligned flush trimming can never strand part of one.  Framed
+// encodings only: under ENC_VARINT the frame bytes read as continuation
+// bytes, so CONF:STATS and CONF:ENC reject the combination (-221).  Off by
+// default: a host parser that predates the marker would misframe on 0xAB.
+#define STATS_MARKER_BYTE 0xAB
+#define STATS_FRAME_LEN 24
+#define STATS_EMIT_INTERVAL_MS 1000UL
+
+// --- Ring watermark degradation (CONF:WMARK) ---------------------------------
+// When the ring backlog at drain start crosses the configured high watermark,
+// per-event streaming degrades to decimation instead of letting gmISR() drop
+// pulses invisibly: 1 event in DEGRADE_KEEP_RATIO is emitted as a 12-byte
+// frame [0xB0, skipped LE16, delta LE32, 4 reserved (0), 0x55] whose skipped
+// field counts the suppressed events since the previous frame — the integral
+// count survives a burst exactly, only per-event timing is thinned.  The mode
+// exits (with a final skipped-only frame, delta = 0) once the backlog falls
+// below half the watermark; rate-only measurements keep an unbroken record
+// through bursts that previously punched holes in the data.  Fixed-encoding
+// streaming only — the frame would corrupt the varint/seq byte streams.
+// Watermark 0 (default) disables the policy: a host parser that predates the
+// 0xB0 marker would misframe on it.
+#define DEGRADE_MARKER_BYTE 0xB0
+#define DEGRADE_FRAME_LEN 12 // multiple of the 6-byte packet — alignment-safe
+#define DEGRADE_KEEP_RATIO 8 // emit 1 event in 8 while degraded
+#define DEFAULT_DEGRADE_WATERMARK 0
+
+// --- Dead-time classification (CONF:DEAD) ----------------------------------------
+// Multi-threshold classifier applied to every accepted delta in the drain
+// path, against the configured tube dead time τ.  Deltas below τ are
+// physically suspect — the tube cannot re-fire that fast, so they point at
+// afterpulses, EMI, or double-counted edges — and land in subDead; deltas in
+// [τ, 2τ) land in nearDead, the tail a dead-time fit weighs most.  With the
+// classification on-device, a tail-only run needs one DIAG:STAT? line per
+// point instead of a full raw-delta stream.  The counters also ride in the
+// formerly reserved bytes of the 0xAB sideband (two LE16, saturating), so
+// they are visible while the run is still going.  The default matches the
+// ~200 µs dead time of the SBM-20-class tubes in use; CONF:DEAD <us> tunes
+// it per tube.
+#define DEFAULT_DEADTIME_US 200UL
+#define DEADTIME_MAX_US 100000UL // 100 ms — far above any plausible GM tube
+
+// --- Session trailer (after the 0xEE end sentinel) ---------------------------
+// Self-describing binary record appended after the 6 × 0xEE end-of-period
+// sentinel, so a raw capture file carries its own format version, encoder
+// config, tick rate and loss counters — host tools can memory-map and replay
+// archived runs without consulting per-session config files.  Layout (LE):
+//   [0xB1, version, encoding, acq_mode, ticks_per_us LE16, duration_ms LE32,
+//    nPoints LE32, debounced LE32, overflows LE32, txDrops LE32,
+//    subDead LE16, nearDead LE16, last_seq, 0x55]
+// txDrops doubles as the sequence-gap count under ENC_SEQ (every dropped
+// packet is one gap); last_seq lets the host close the final gap window.
+// Opt-in via CONF:TRAIL, default off: the host PacketParser stays in sync
+// after the 0xEE sentinel, so a parser that does not know the trailer would
+// frame its 0xAA/0x55 byte pairs as phantom data points.  Same rule as every
+// other post-baseline frame type (0xAB/0xAD/0xA9/0xB0).
+#define TRAILER_MARKER_BYTE 0xB1
+#define TRAILER_FORMAT_VERSION 1
+#define TRAILER_FRAME_LEN 32
+#define DEFAULT_TRAILER 0 // 0 = off — only hosts that ask for it can parse it
+
+// --- Binary fast-path opcodes (host → device) --------------------------------
+// Single high-bit bytes recognized at the top of the Serial read loop, before
+// newline accumulation, and routed straight to the INIT / ABOR / CONF:VOLT
+// handlers.  Text commands are 7-bit ASCII, so a byte ≥ 0x80 can never be part
+// of one — there is no ambiguity and no mode switch.  OP_VOLT is followed by
+// one operand byte: voltage = GM_VOLTAGE_MIN + 2 × operand (0..200 → 300..700 V).
+// For scripted sweeps this cuts per-command latency to near the USB transit
+// time.
+#define OP_INIT 0x81
+#define OP_ABOR 0x82
+#define OP_VOLT 0x83
+
+// --- Clock-sync epoch (CONF:SYNC / SYST:SYNC?) -----------------------------------
+// Opt-in 0xAD-framed packet emitted immediately after the 0xFF×6 start marker:
+// [0xAD, ticks LE32, millis LE32, 2 reserved bytes (0), 0x55] — 12 bytes.
+// Pairs the high-res tick counter with the millisecond clock at stream start so
+// the host can fit a clock offset/drift model and align counter events with
+// other instruments' logs (HV supply, motorized stage) without any per-event
+// overhead.  SYST:SYNC? returns the same pair as text on demand, letting the
+// host re-sample the pairing and estimate drift over long sessions.  Off by
+// default: a host parser that predates the marker would misframe on 0xAD.
+#define EPOCH_MARKER_BYTE 0xAD
+#define EPOCH_FRAME_LEN 12
+
+// --- Drain-cycle profiler (DIAG:PROF?) -------------------------------------------
+// Log2 histogram of the interval between successive drain passes: bin i counts
+// gaps in [2^i, 2^(i+1)) µs.  16 bins put everything ≥ 32.8 ms — far beyond
+// any healthy loop() iteration — in the top bin.
+#define PROF_BINS 16
+
+// --- Self-test (DIAG:SELFTEST?) ------------------------------------------------
+// The self-test drives the acquisition pipeline with internally generated
+// pulses, sweeping the rate upward and reporting the highest rate sustained
+// with zero overflows and zero txDrops.  USB throughput differs between
+// deployed units, so each board's loss-free ceiling can be qualified in
+// seconds without a function generator.
+//
+// SELFTEST_RATE_MAX_HZ stays below the debounce-implied ceiling: at
+// DEBOUNCE_US = 10 a period under ~20 µs starts losing events to the debounce
+// filter, which would masquerade as a "clean" (packet-free) trial.
+#define SELFTEST_RATE_MIN_HZ 1000UL
+#define SELFTEST_RATE_MAX_HZ 50000UL
+#define SELFTEST_TRIAL_MS 100UL
+#define SELFTEST_MIN_EVENTS 100UL
 
 // --- Ring buffer (power of 2) ---
 // 1024 × 4 B = 4 KB of the RA4M1's 32 KB SRAM.  At 10 kHz this buffers ~102 ms
@@ -73,6 +348,9 @@
 
 // --- Error queue ---
 #define ERR_QUEUE_SIZE 8
+// Per-entry storage; sized to the largest stack buffer the err* helpers in
+// scpi.cpp format into (errParam's 80), so no message is ever truncated twice.
+#define ERR_MSG_LEN 80
 
 // --- GM counter hardware limits ---
 #define GM_VOLTAGE_MIN 300
@@ -87,6 +365,11 @@
 #define DEFAULT_TIME_MODE 2
 #define DEFAULT_REPEAT 0      // 0 = off
 #define DEFAULT_STREAM_MODE 0 // 0 = off
+#define DEFAULT_ENCODING ENC_FIXED
+#define DEFAULT_ACQ_MODE ACQ_STREAM
+#define DEFAULT_STATS_SIDEBAND 0 // 0 = off
+#define DEFAULT_SYNC_EPOCH 0     // 0 = off
+#define DEFAULT_CH2 0            // 0 = off
 
 // --- End-of-period detection -------------------------------------------------
 // The GM counter supports "e1" (send result when counting period ends).  When
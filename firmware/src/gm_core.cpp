@@ -12,26 +12,65 @@
 #define DWT_CTRL_CYCCNTENA (1UL << 0)
 #endif
 
+// ── GPT input capture (RA4M1 GPT channel 1 / GPT321) ──────────────────────────
+// Approach C from docs/TIMING_AND_GPT_TIMER.md.  The GPT latches GTCNT into
+// GTCCRA in hardware at the rising edge on GTIOC1A (= D2 / P105), so the value
+// read in gmISR() is the edge time regardless of interrupt-entry latency.  The
+// pin interrupt itself stays on the normal attachInterrupt() path (PFS ISEL is
+// independent of the peripheral function select), so the ISR/ring pipeline is
+// unchanged — only the clock source read in captureTicks() differs.
+#if USE_GPT_CAPTURE
+#include <Arduino.h> // pulls in the Renesas device headers (R_GPT321, R_PFS, R_MSTP)
+#endif
+
 static volatile uint32_t _timestamps[RING_BUF_SIZE];
 static volatile uint16_t _writeIdx = 0; // uint16_t: RING_BUF_SIZE may exceed 256
 static volatile uint16_t _readIdx = 0;
-static volatile uint32_t _overflowCnt = 0; // pulses dropped due to full buffer
-static uint32_t _lastTs = 0;
+static volatile uint32_t _overflowCnt = 0; // pulses dropped (cumulative per run;
+                                           // mirrored into acqStats, zeroed only
+                                           // at start/reset — never in the drain)
 static bool _hasLastTs = false;
 
+// ── 64-bit wrap extension ─────────────────────────────────────────────────────
+// The raw counter is 32-bit and wraps every 2^32 ticks (~89.48 s at 48 MHz,
+// ~71.6 min in micros() mode).  The drain loop — never the ISR, so there is no
+// ISR/loop wrap race — extends timestamps to 64 bits: every call to
+// gmProcessAcquisition() samples the live counter and counts wraps (loop() runs
+// many orders of magnitude more often than the wrap period), then places each
+// popped ring timestamp into the correct epoch by comparing against the live
+// 64-bit time.  Deltas are computed in 64 bits; the 6-byte wire format still
+// carries 32 bits, so a delta longer than 2^32 ticks saturates at 0xFFFFFFFF
+// instead of silently aliasing into the seconds range.
+static uint64_t _wrapEpochBase = 0; // completed wraps, pre-shifted (n << 32)
+static uint32_t _lastRawSample = 0; // previous live-counter sample (wrap detect)
+static uint64_t _lastTs64 = 0;
+
 // Read the current timestamp in "ticks" (CYCCNT @ 48 MHz, or micros() in tests).
 // Marked always-inline so the ISR stays as short as possible.
 //
-// WRAP LIMIT: CYCCNT is 32-bit at 48 MHz and wraps every 2^32/48e6 ≈ 89.48 s.
-// The unsigned delta in gmProcessAcquisition() is correct across ONE wrap, so any
-// inter-event gap < ~89.48 s is exact.  A gap >= 89.48 s is SILENTLY misread as
-// (gap - 89.48 s) — see docs/TIMING_AND_GPT_TIMER.md.  This is harmless for
-// dead-time runs and normal background (mean gap << 89 s), but for an ultra-weak
-// source whose mean gap approaches a minute, build with -DUSE_CYCLE_COUNTER=0 to
-// use micros() instead (1 µs resolution, ~71.6 min wrap).
+// WRAP LIMIT: the raw value is 32-bit and wraps every 2^32 ticks (~89.48 s at
+// 48 MHz).  gmProcessAcquisition() extends timestamps to 64 bits via the wrap
+// epoch above, so arbitrarily long gaps are measured correctly; only the final
+// 32-bit wire delta saturates at 2^32 - 1 ticks (see txAppend caller).
 static inline uint32_t captureTicks()
 {
-#if USE_CYCLE_COUNTER
+#if USE_GPT_CAPTURE
+    // Latched by hardware at the pin edge — immune to ISR-entry jitter.
+    return R_GPT321->GTCCR[0]; // GTCCRA
+#elif USE_CYCLE_COUNTER
+    return DWT_CYCCNT;
+#else
+    return micros();
+#endif
+}
+
+// Read the live (free-running) counter — used by the drain loop's wrap detector.
+// In GPT-capture mode this is GTCNT, not the GTCCRA latch captureTicks() reads.
+static inline uint32_t liveTicks()
+{
+#if USE_GPT_CAPTURE
+    return R_GPT321->GTCNT;
+#elif USE_CYCLE_COUNTER
     return DWT_CYCCNT;
 #else
     return micros();
@@ -51,54 +90,283 @@ void gmISR()
     _writeIdx = next;
 }
 
+// ── Channel 2 ring (CONF:CH2) ────────────────────────────────────────────────
+// Same single-producer/single-consumer discipline as channel 1, against its
+// own (smaller) ring.  Timestamps come from the same counter, so both
+// channels share one timebase — that is the whole point (config.h).
+
+static volatile uint32_t _timestamps2[RING2_BUF_SIZE];
+static volatile uint16_t _writeIdx2 = 0;
+static volatile uint16_t _readIdx2 = 0;
+static volatile uint32_t _overflowCnt2 = 0;
+static uint64_t _lastTs64Ch2 = 0;
+
+void gmISR2()
+{
+    uint16_t next = (_writeIdx2 + 1) & RING2_BUF_MASK;
+    if (next == _readIdx2)
+    {
+        _overflowCnt2++; // buffer full — drop this pulse
+        return;
+    }
+    // No hardware capture latch on D3 — channel 2 always reads the live
+    // counter (ISR-entry jitter applies; fine for coincidence-window widths).
+    _timestamps2[_writeIdx2] = liveTicks();
+    _writeIdx2 = next;
+}
+
+// ── Clock-sync epoch (CONF:SYNC / SYST:SYNC?) ────────────────────────────────
+
+void gmClockSample(uint32_t &ticks, uint32_t &ms)
+{
+    ticks = liveTicks();
+    ms = (uint32_t)millis();
+}
+
+// Write the 0xAD epoch packet.  gmStartAcquisition() calls this right after
+// the start marker, before anything can enter _txBuf, so packet-aligned flush
+// trimming never sees it.
+static void epochEmit()
+{
+    uint32_t ticks, ms;
+    gmClockSample(ticks, ms);
+    uint8_t p[EPOCH_FRAME_LEN] = {0};
+    p[0] = EPOCH_MARKER_BYTE;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        p[1 + i] = (uint8_t)((ticks >> (8 * i)) & 0xFF);
+        p[5 + i] = (uint8_t)((ms >> (8 * i)) & 0xFF);
+    }
+    p[EPOCH_FRAME_LEN - 1] = 0x55;
+    Serial.write(p, EPOCH_FRAME_LEN);
+}
+
+// ── Drain-cycle profiler (DIAG:PROF?) ────────────────────────────────────────
+//
+// When a run reports overflows the question is always *why the drain loop
+// stalled* — a USB hiccup, a long SCPI dispatch, a Serial1 wait.  This keeps
+// a log2 histogram of the gap between successive drain passes plus high-water
+// marks for ring occupancy and TX fill, all O(1) per pass, so the worst-case
+// latency picture is one text query instead of a logic-analyzer session.
+
+static GmProfile _prof;
+static uint32_t _profLastTicks = 0;
+static bool _profHasLast = false;
+
+void gmProfileReset()
+{
+    memset(&_prof, 0, sizeof(_prof));
+    _profHasLast = false;
+}
+
+const GmProfile &gmProfile() { return _prof; }
+
+// Record one drain-pass entry at *nowTicks*.  Bin index = floor(log2(gap_us)),
+// clamped to the top bin; tick-arithmetic wraps are handled by the usual
+// unsigned subtraction.
+static inline void profRecord(uint32_t nowTicks)
+{
+    if (_profHasLast)
+    {
+        uint32_t gapUs = (nowTicks - _profLastTicks) / TICKS_PER_US;
+        if (gapUs > _prof.maxGapUs)
+            _prof.maxGapUs = gapUs;
+        uint8_t bin = 0;
+        while (bin < PROF_BINS - 1 && (gapUs >> (bin + 1)) != 0)
+            bin++;
+        _prof.bins[bin]++;
+    }
+    _profLastTicks = nowTicks;
+    _profHasLast = true;
+}
+
 // ── USB TX batching ───────────────────────────────────────────────────────────
-// Packets are coalesced into _txBuf and flushed with non-blocking writes.
-// _txBuf is TX_BUF_PACKETS × 6 bytes — larger than TX_BATCH_PACKETS × 6 so
-// partial-flush residue fits without overflow when the USB host is temporarily
-// slow.  txFlush() never blocks: it writes only what availableForWrite() can
-// accept and leaves the rest for the next drain cycle.  This guarantees that
-// gmProcessAcquisition() is never stalled by USB back-pressure, which would
-// prevent the ring buffer from draining and produce artificial large deltas.
-static uint8_t _txBuf[TX_BUF_PACKETS * 6];
-static uint16_t _txLen = 0;
+// Packets are coalesced and flushed with non-blocking writes through a
+// ping-pong buffer pair: the appenders build into _txBuf (one half) while
+// txFlush() drains the other half via a read offset, so a partial flush leaves
+// its residue in place instead of memmove-sliding it to the front — at high
+// rates with a congested host that copy used to run on every drain cycle.
+// Each half holds TX_BUF_PACKETS packets — large enough for the biggest
+// single frame (a linear-histogram snapshot).  txFlush() never blocks: it
+// writes only what
+// availableForWrite() can accept and leaves the rest for the next drain
+// cycle.  This guarantees that gmProcessAcquisition() is never stalled by USB
+// back-pressure, which would prevent the ring buffer from draining and
+// produce artificial large deltas.
+static const uint16_t TX_HALF_BYTES = TX_BUF_PACKETS * 6;
+static uint8_t _txBufs[2][TX_HALF_BYTES];
+static uint8_t *_txBuf = _txBufs[0]; // build half — appenders write here
+static uint16_t _txLen = 0;          // bytes built so far in _txBuf
+static uint8_t *_txDrain = _txBufs[1];
+static uint16_t _txDrainLen = 0;         // bytes committed to the drain half
+static uint16_t _txDrainRead = 0;        // bytes of those already on the wire
+static unsigned long _txFirstHeldMs = 0; // when the oldest held byte arrived
+
+// Bytes waiting anywhere in the pipeline — build half plus drain residue.
+static inline uint16_t txPending()
+{
+    return (uint16_t)(_txLen + (_txDrainLen - _txDrainRead));
+}
+
+// Record the hold start when data enters an empty pipeline — the drain loop
+// flushes anything older than TX_FLUSH_DEADLINE_MS (rate-adaptive batching).
+static inline void txNoteHeld()
+{
+    if (txPending() == 0)
+        _txFirstHeldMs = millis();
+}
 
 static void txFlush()
 {
-    if (_txLen == 0)
+    uint16_t pendingAll = txPending();
+    if (pendingAll == 0)
         return;
 
-    int avail = Serial.availableForWrite();
-    if (avail < 6)
-        return; // USB TX buffer full — leave data, retry on next drain cycle
+    if (pendingAll > _prof.txLenPeak)
+        _prof.txLenPeak = pendingAll;
 
-    size_t toWrite = ((size_t)avail < (size_t)_txLen) ? (size_t)avail : (size_t)_txLen;
-    toWrite -= toWrite % 6; // packet-aligned: never split a framed packet
-    if (toWrite == 0)
+    for (;;)
+    {
+        if (_txDrainRead >= _txDrainLen)
+        {
+            // Drain half exhausted — swap in the build half if non-empty.
+            if (_txLen == 0)
+                return;
+            uint8_t *t = _txBuf;
+            _txBuf = _txDrain;
+            _txDrain = t;
+            _txDrainLen = _txLen;
+            _txDrainRead = 0;
+            _txLen = 0;
+        }
+
+        int avail = Serial.availableForWrite();
+        if (avail < 6)
+            return; // USB TX buffer full — leave data, retry on next drain cycle
+
+        size_t pending = (size_t)(_txDrainLen - _txDrainRead);
+        size_t toWrite = ((size_t)avail < pending) ? (size_t)avail : pending;
+        if (gmState.acq_mode == ACQ_STREAM)
+        {
+            // Packet-aligned: never split a framed packet across flushes.
+            if (gmState.encoding == ENC_FIXED)
+                toWrite -= toWrite % 6;
+            else if (gmState.encoding == ENC_SEQ)
+                toWrite -= toWrite % SEQ_FRAME_LEN;
+            // (varint deltas have no frame granularity — any split point is
+            //  recoverable because bytes are written in order)
+        }
+        if (toWrite == 0)
+            return;
+
+        Serial.write(_txDrain + _txDrainRead, toWrite);
+        _txDrainRead += (uint16_t)toWrite;
+
+        if (_txDrainRead < _txDrainLen)
+            return; // host back-pressure — residue stays put, no copying
+    }
+}
+
+// ── Sequenced frames (ENC_SEQ) ────────────────────────────────────────────────
+static uint8_t _txSeq = 0;
+
+// CRC-8, polynomial 0x07, init 0x00 — over the seq byte plus the 4 payload bytes.
+static uint8_t crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+    while (len--)
+    {
+        crc ^= *data++;
+        for (uint8_t i = 0; i < 8; i++)
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+// Append a delta as an 8-byte sequenced frame (see config.h for the layout).
+// The sequence counter advances even when the frame is dropped, so TX loss
+// shows up as a seq gap on the host instead of silently vanishing.
+static void txAppendSeq(uint32_t value)
+{
+    if (_txLen + SEQ_FRAME_LEN > TX_HALF_BYTES)
+    {
+        acqStats.txDrops++;
+        _txSeq++; // burn the number — the host must see the gap
         return;
+    }
+    txNoteHeld();
+    uint8_t *p = &_txBuf[_txLen];
+    p[0] = 0xAA;
+    p[1] = _txSeq++;
+    p[2] = (uint8_t)(value & 0xFF);
+    p[3] = (uint8_t)((value >> 8) & 0xFF);
+    p[4] = (uint8_t)((value >> 16) & 0xFF);
+    p[5] = (uint8_t)((value >> 24) & 0xFF);
+    p[6] = crc8(&p[1], 5);
+    p[7] = 0x55;
+    _txLen += SEQ_FRAME_LEN;
+    if (_txLen >= (uint16_t)(TX_BATCH_PACKETS * 6))
+        txFlush();
+}
 
-    Serial.write(_txBuf, toWrite);
+// ── Varint encoding (ENC_VARINT) ──────────────────────────────────────────────
+// Deltas down-counted until the next 5 × 0xFF resync marker (see config.h).
+static uint8_t _varintCountdown = VARINT_RESYNC_INTERVAL;
 
-    if (toWrite == _txLen)
+// Append a delta as an LEB128 varint (1–5 bytes), preceded every
+// VARINT_RESYNC_INTERVAL deltas by the resync marker.  Flush when batch full.
+static void txAppendVarint(uint32_t value)
+{
+    // Worst case: full resync marker plus a maximum-length varint.
+    if (_txLen + VARINT_RESYNC_LEN + 5 > TX_HALF_BYTES)
     {
-        _txLen = 0;
+        acqStats.txDrops++;
+        return;
     }
-    else
+    txNoteHeld();
+
+    if (_varintCountdown == 0)
     {
-        // Slide unwritten residue to the front for next flush attempt.
-        memmove(_txBuf, _txBuf + toWrite, _txLen - toWrite);
-        _txLen -= (uint16_t)toWrite;
+        for (uint8_t i = 0; i < VARINT_RESYNC_LEN; i++)
+            _txBuf[_txLen++] = VARINT_RESYNC_BYTE;
+        _varintCountdown = VARINT_RESYNC_INTERVAL;
     }
+    _varintCountdown--;
+
+    // LEB128: 7 data bits per byte, MSB set on all but the final byte.
+    do
+    {
+        uint8_t b = (uint8_t)(value & 0x7F);
+        value >>= 7;
+        if (value != 0)
+            b |= 0x80;
+        _txBuf[_txLen++] = b;
+    } while (value != 0);
+
+    if (_txLen >= (uint16_t)(TX_BATCH_PACKETS * 6))
+        txFlush();
 }
 
 // Append a 32-bit tick delta as a framed 6-byte packet, flush when batch full.
 static void txAppend(uint32_t value)
 {
-    if (_txLen + 6 > sizeof(_txBuf))
+    if (gmState.encoding == ENC_VARINT)
+    {
+        txAppendVarint(value);
+        return;
+    }
+    if (gmState.encoding == ENC_SEQ)
+    {
+        txAppendSeq(value);
+        return;
+    }
+    if (_txLen + 6 > TX_HALF_BYTES)
     {
         // Residue from repeated partial flushes filled the buffer — drop packet.
         acqStats.txDrops++;
         return;
     }
+    txNoteHeld();
     uint8_t *p = &_txBuf[_txLen];
     p[0] = 0xAA;
     p[1] = (uint8_t)(value & 0xFF);
@@ -111,6 +379,540 @@ static void txAppend(uint32_t value)
         txFlush();
 }
 
+// Channel-2 frame: identical fixed layout, 0xA9 marker.  Only reachable with
+// ENC_FIXED (CONF:CH2 enforces that), so no varint/seq dispatch here.
+static void txAppendCh2(uint32_t value)
+{
+    if (_txLen + 6 > TX_HALF_BYTES)
+    {
+        acqStats.txDrops++;
+        return;
+    }
+    txNoteHeld();
+    uint8_t *p = &_txBuf[_txLen];
+    p[0] = CH2_MARKER_BYTE;
+    p[1] = (uint8_t)(value & 0xFF);
+    p[2] = (uint8_t)((value >> 8) & 0xFF);
+    p[3] = (uint8_t)((value >> 16) & 0xFF);
+    p[4] = (uint8_t)((value >> 24) & 0xFF);
+    p[5] = 0x55;
+    _txLen += 6;
+    if (_txLen >= (uint16_t)(TX_BATCH_PACKETS * 6))
+        txFlush();
+}
+
+// Configure GPT channel 1 for free-running input capture on GTIOC1A (D2/P105).
+// Call once from setup(), AFTER attachInterrupt() so the read-modify-write of
+// PmnPFS preserves the ISEL (pin-IRQ enable) bit the core just set.
+// No-op unless built with -DUSE_GPT_CAPTURE=1 (hardware-validated only).
+void gmEnableInputCapture()
+{
+#if USE_GPT_CAPTURE
+    // Release the GPT32 (channels 0–1) module stop so the peripheral is clocked.
+    R_MSTP->MSTPCRD &= ~(1UL << 5);
+
+    // Mux P105 to its GPT peripheral function (PSEL = 3 → GTIOC1A) while keeping
+    // ISEL set — the port IRQ for attachInterrupt() and the capture input share
+    // the pin.  PFS writes require the PWPR unlock sequence.
+    R_PMISC->PWPR = 0x00;                                   // B0WI = 0
+    R_PMISC->PWPR = 0x40;                                   // PFSWE = 1
+    uint32_t pfs = R_PFS->PORT[1].PIN[5].PmnPFS;            // P105
+    pfs &= ~(0x1FUL << 24);                                 // clear PSEL
+    pfs |= (3UL << 24)                                      // PSEL = GPT1 function
+           | (1UL << 16)                                    // PMR: peripheral mode
+           | (1UL << 14);                                   // ISEL: keep pin IRQ
+    R_PFS->PORT[1].PIN[5].PmnPFS = pfs;
+    R_PMISC->PWPR = 0x00;                                   // PFSWE = 0
+    R_PMISC->PWPR = 0x80;                                   // B0WI = 1 (re-lock)
+
+    // GPT1: disable write protection, free-running saw-wave up-count from
+    // PCLKD/1 (48 MHz → TICKS_PER_US == 48, same wrap behaviour as CYCCNT).
+    R_GPT321->GTWP = 0xA500;      // key 0xA5, WP = 0
+    R_GPT321->GTCR = 0;           // MD = saw-wave, TPCS = PCLKD/1, stopped
+    R_GPT321->GTCNT = 0;
+    // Capture GTCNT into GTCCRA on every rising edge of GTIOC1A (bits 8/9:
+    // rising edge while GTIOCB low/high — both set so the B level is ignored).
+    R_GPT321->GTICASR = (1UL << 8) | (1UL << 9);
+    R_GPT321->GTCR |= 1UL;        // CST: start counting
+#endif
+}
+
+// ── On-device histogram (ACQ_HIST) ────────────────────────────────────────────
+// In histogram mode the drain loop bins each delta instead of calling
+// txAppend(), and a cumulative bin-array frame goes to the host once per
+// second (see config.h for the frame layout and binning rules).
+
+static uint32_t _histBins[HIST_LIN_BINS]; // sized for the larger (linear) layout
+static bool _histLinear = false;          // false = log2 bins (default)
+static uint32_t _histWidthTicks = 100UL * TICKS_PER_US; // linear bin width
+static unsigned long _histLastEmitMs = 0;
+
+void gmConfigureHistogram(bool linear, uint32_t width_ticks)
+{
+    _histLinear = linear;
+    if (width_ticks > 0)
+        _histWidthTicks = width_ticks;
+}
+
+bool gmHistogramIsLinear() { return _histLinear; }
+uint32_t gmHistogramWidthTicks() { return _histWidthTicks; }
+
+static inline uint8_t histNumBins()
+{
+    return _histLinear ? HIST_LIN_BINS : HIST_LOG_BINS;
+}
+
+static void histCount(uint32_t delta)
+{
+    uint8_t bin;
+    if (_histLinear)
+    {
+        uint32_t b = delta / _histWidthTicks;
+        bin = (b >= HIST_LIN_BINS) ? (HIST_LIN_BINS - 1) : (uint8_t)b;
+    }
+    else
+    {
+        // bin = floor(log2(delta)); delta 0/1 both land in bin 0.
+        bin = 0;
+        while (delta >>= 1)
+            bin++;
+    }
+    if (_histBins[bin] != 0xFFFFFFFFUL)
+        _histBins[bin]++; // saturate — never wrap a count
+}
+
+// Append one histogram frame to the TX buffer; txFlush() drains it like any
+// other TX data.  Dropped silently (txDrops) if residue has filled the buffer.
+static void histEmit()
+{
+    uint8_t nbins = histNumBins();
+    uint16_t frameLen = (uint16_t)(2 + 4 * nbins + 1);
+    if (_txLen + frameLen > TX_HALF_BYTES)
+    {
+        acqStats.txDrops++;
+        return;
+    }
+    _txBuf[_txLen++] = HIST_MARKER_BYTE;
+    _txBuf[_txLen++] = nbins;
+    for (uint8_t i = 0; i < nbins; i++)
+    {
+        uint32_t v = _histBins[i];
+        _txBuf[_txLen++] = (uint8_t)(v & 0xFF);
+        _txBuf[_txLen++] = (uint8_t)((v >> 8) & 0xFF);
+        _txBuf[_txLen++] = (uint8_t)((v >> 16) & 0xFF);
+        _txBuf[_txLen++] = (uint8_t)((v >> 24) & 0xFF);
+    }
+    _txBuf[_txLen++] = 0x55;
+    txFlush();
+}
+
+// ── MCS interval counting (ACQ_MCS) ───────────────────────────────────────────
+// Counts-per-bin streaming: the drain loop accumulates accepted events into
+// fixed-width time bins and emits one 8-byte frame per bin boundary (layout
+// and rationale in config.h).  The first pulse only seeds the delta timebase,
+// so bin counts are accepted *deltas*, consistent with every other mode.
+
+static uint32_t _mcsWidthTicks = DEFAULT_MCS_WIDTH_US * TICKS_PER_US;
+static uint64_t _mcsBinStart64 = 0; // 64-bit epoch tick of the current bin start
+static uint16_t _mcsBinIdx = 0;
+static uint32_t _mcsCount = 0;
+
+void gmConfigureMcs(uint32_t width_us)
+{
+    if (width_us > 0)
+        _mcsWidthTicks = width_us * TICKS_PER_US;
+}
+
+uint32_t gmMcsWidthUs() { return _mcsWidthTicks / TICKS_PER_US; }
+
+// Append the current bin's count frame; txFlush() drains it like any other TX
+// data.  Dropped silently (txDrops) if residue has filled the buffer.
+static void mcsEmit()
+{
+    if (_txLen + MCS_FRAME_LEN > TX_HALF_BYTES)
+    {
+        acqStats.txDrops++;
+        return;
+    }
+    uint8_t *p = _txBuf + _txLen;
+    p[0] = MCS_MARKER_BYTE;
+    p[1] = (uint8_t)(_mcsBinIdx & 0xFF);
+    p[2] = (uint8_t)(_mcsBinIdx >> 8);
+    p[3] = (uint8_t)(_mcsCount & 0xFF);
+    p[4] = (uint8_t)((_mcsCount >> 8) & 0xFF);
+    p[5] = (uint8_t)((_mcsCount >> 16) & 0xFF);
+    p[6] = (uint8_t)((_mcsCount >> 24) & 0xFF);
+    p[7] = 0x55;
+    _txLen += MCS_FRAME_LEN;
+    txNoteHeld();
+    txFlush();
+}
+
+// Close every bin that ended at or before *t64* — empty bins emit too, so the
+// host sees an unbroken bin sequence regardless of the pulse rate.
+static void mcsCatchUp(uint64_t t64)
+{
+    while (t64 - _mcsBinStart64 >= _mcsWidthTicks)
+    {
+        mcsEmit();
+        _mcsBinStart64 += _mcsWidthTicks;
+        _mcsBinIdx++;
+        _mcsCount = 0;
+    }
+}
+
+// ── RNG entropy extraction (ACQ_RNG) ──────────────────────────────────────────
+// Harvests the least-significant tick bit of every accepted delta, debiases
+// (von Neumann or parity folding — trade-offs in config.h), and streams the
+// result as [0xAF, 16 entropy bytes, 0x55] frames.  All state below is
+// cleared at stream start so every run's output is self-contained.
+
+static uint8_t _rngMethod = DEFAULT_RNG_METHOD;
+static uint8_t _rngBuf[RNG_PAYLOAD_BYTES]; // packed bytes awaiting a frame
+static uint8_t _rngLen = 0;
+static uint8_t _rngByte = 0;    // byte currently being filled, MSB first
+static uint8_t _rngBitCnt = 0;  // bits already in _rngByte
+static uint8_t _rngVnPrev = 0;  // first bit of the current von Neumann pair
+static bool _rngVnHavePrev = false;
+
+void gmConfigureRng(uint8_t method) { _rngMethod = method; }
+uint8_t gmRngMethod() { return _rngMethod; }
+
+// Append one full payload as a frame; txFlush() drains it like any other TX
+// data.  Dropped silently (txDrops) if residue has filled the buffer.
+static void rngEmitFrame()
+{
+    if (_txLen + RNG_FRAME_LEN > TX_HALF_BYTES)
+    {
+        acqStats.txDrops++;
+        _rngLen = 0;
+        return;
+    }
+    uint8_t *p = _txBuf + _txLen;
+    p[0] = RNG_MARKER_BYTE;
+    for (uint8_t i = 0; i < RNG_PAYLOAD_BYTES; i++)
+        p[1 + i] = _rngBuf[i];
+    p[1 + RNG_PAYLOAD_BYTES] = 0x55;
+    _txLen += RNG_FRAME_LEN;
+    _rngLen = 0;
+    txNoteHeld();
+    txFlush();
+}
+
+static void rngEmitBit(uint8_t bit)
+{
+    _rngByte = (uint8_t)((_rngByte << 1) | (bit & 1));
+    if (++_rngBitCnt == 8)
+    {
+        _rngBuf[_rngLen++] = _rngByte;
+        _rngByte = 0;
+        _rngBitCnt = 0;
+        if (_rngLen == RNG_PAYLOAD_BYTES)
+            rngEmitFrame();
+    }
+}
+
+// Fold one accepted delta into the extractor.
+static void rngFeed(uint32_t delta)
+{
+    if (_rngMethod == RNG_PARITY)
+    {
+        // XOR-fold the low byte down to its parity — one output bit per event.
+        uint8_t b = (uint8_t)(delta & 0xFF);
+        b ^= (uint8_t)(b >> 4);
+        b ^= (uint8_t)(b >> 2);
+        b ^= (uint8_t)(b >> 1);
+        rngEmitBit(b);
+        return;
+    }
+    // Von Neumann on successive LSBs: 01→0, 10→1, 00/11 discarded.
+    uint8_t raw = (uint8_t)(delta & 1);
+    if (!_rngVnHavePrev)
+    {
+        _rngVnPrev = raw;
+        _rngVnHavePrev = true;
+        return;
+    }
+    _rngVnHavePrev = false;
+    if (_rngVnPrev != raw)
+        rngEmitBit(_rngVnPrev);
+}
+
+// Drop all partial extractor state — bits from one run never leak into the
+// next, and an attacker who sees run N learns nothing about run N+1's start.
+static void rngReset()
+{
+    _rngLen = 0;
+    _rngByte = 0;
+    _rngBitCnt = 0;
+    _rngVnHavePrev = false;
+}
+
+// ── Burst capture (ACQ_BURST) ─────────────────────────────────────────────────
+// During capture the drain loop stores deltas here instead of touching the TX
+// path at all; playback streams the array out once the target is reached.
+// Capture keeps the full ISR → ring → debounce → 64-bit delta pipeline, so a
+// burst recording is bit-identical to what live streaming would have produced
+// — minus the losses.
+
+static uint32_t _burstBuf[BURST_BUF_SIZE]; // 16 KB — by far the largest buffer
+static uint32_t _burstLen = 0;
+static uint32_t _burstTarget = BURST_BUF_SIZE;
+
+// Set when a burst run stops itself; loop() consumes it and sends s0/e0 so
+// the GM counter actually stops counting (see gmTakeHwStopPending).
+static bool _hwStopPending = false;
+
+bool gmTakeHwStopPending()
+{
+    bool pending = _hwStopPending;
+    _hwStopPending = false;
+    return pending;
+}
+
+void gmConfigureBurst(uint32_t n_events)
+{
+    if (n_events == 0 || n_events > BURST_BUF_SIZE)
+        n_events = BURST_BUF_SIZE;
+    _burstTarget = n_events;
+}
+
+uint32_t gmBurstTarget() { return _burstTarget; }
+
+// Store one delta; returns true once the capture target has been reached.
+static bool burstStore(uint32_t delta)
+{
+    if (_burstLen < _burstTarget)
+        _burstBuf[_burstLen++] = delta;
+    return _burstLen >= _burstTarget;
+}
+
+// Stream the captured deltas out in the configured encoding.  Per-packet
+// bounded retries mirror gmStopAcquisition(): a vanished host costs at most
+// ~50 ms per stuck packet instead of hanging the firmware.
+static void burstPlayback()
+{
+    for (uint32_t i = 0; i < _burstLen; i++)
+    {
+        // Worst-case headroom: a resync marker plus a maximum-length varint.
+        for (uint8_t t = 0; t < 100 && _txLen + VARINT_RESYNC_LEN + 5 > TX_HALF_BYTES; t++)
+        {
+            txFlush();
+            delayMicroseconds(500);
+        }
+        txAppend(_burstBuf[i]);
+    }
+    _burstLen = 0;
+}
+
+// ── Dead-time classification (CONF:DEAD) ─────────────────────────────────────
+
+static uint32_t _deadtimeTicks = (uint32_t)(DEFAULT_DEADTIME_US * TICKS_PER_US);
+
+void gmConfigureDeadtime(uint32_t us)
+{
+    if (us != 0)
+        _deadtimeTicks = us * TICKS_PER_US;
+}
+
+uint32_t gmDeadtimeUs() { return _deadtimeTicks / TICKS_PER_US; }
+
+// Classify one accepted delta against the dead-time thresholds (see config.h).
+// Called from the drain path beside acqStats.addDelta() — same set of deltas,
+// both channels.
+static inline void deadtimeClassify(uint32_t delta)
+{
+    if (delta < _deadtimeTicks)
+        acqStats.subDead++;
+    else if (delta < (_deadtimeTicks << 1))
+        acqStats.nearDead++;
+}
+
+// ── Ring watermark degradation (CONF:WMARK) ──────────────────────────────────
+// Policy, frame layout and rationale in config.h.  Entry/exit is decided once
+// per drain pass from the backlog depth; while active, the ACQ_STREAM routing
+// sends events here instead of txAppend().
+
+static uint16_t _degWatermark = DEFAULT_DEGRADE_WATERMARK; // 0 = disabled
+static bool _degActive = false;
+static uint16_t _degSkipped = 0; // accepted events suppressed since last frame
+
+void gmConfigureWatermark(uint16_t events) { _degWatermark = events; }
+uint16_t gmWatermark() { return _degWatermark; }
+bool gmDegradeActive() { return _degActive; }
+
+// Append one degrade frame; delta == 0 marks the skipped-only exit summary.
+static void degEmit(uint32_t delta)
+{
+    if (_txLen + DEGRADE_FRAME_LEN > TX_HALF_BYTES)
+    {
+        acqStats.txDrops++;
+        _degSkipped = 0; // the suppressed events are lost with the frame
+        return;
+    }
+    txNoteHeld();
+    uint8_t *p = &_txBuf[_txLen];
+    p[0] = DEGRADE_MARKER_BYTE;
+    p[1] = (uint8_t)(_degSkipped & 0xFF);
+    p[2] = (uint8_t)(_degSkipped >> 8);
+    p[3] = (uint8_t)(delta & 0xFF);
+    p[4] = (uint8_t)((delta >> 8) & 0xFF);
+    p[5] = (uint8_t)((delta >> 16) & 0xFF);
+    p[6] = (uint8_t)((delta >> 24) & 0xFF);
+    p[7] = p[8] = p[9] = p[10] = 0; // reserved
+    p[11] = 0x55;
+    _txLen += DEGRADE_FRAME_LEN;
+    _degSkipped = 0;
+    if (_txLen >= (uint16_t)(TX_BATCH_PACKETS * 6))
+        txFlush();
+}
+
+// One accepted ACQ_STREAM event while degraded: suppress until the keep
+// ratio is reached, then emit its delta with the suppressed count.
+static void degFeed(uint32_t delta)
+{
+    if (++_degSkipped >= DEGRADE_KEEP_RATIO)
+    {
+        _degSkipped--; // the emitted event is not "skipped"
+        degEmit(delta);
+    }
+}
+
+// Per-drain-pass policy update from the backlog depth at pass start.
+static void degUpdate(uint16_t backlog)
+{
+    if (_degWatermark == 0 || gmState.acq_mode != ACQ_STREAM ||
+        gmState.encoding != ENC_FIXED)
+        return;
+    if (!_degActive && backlog >= _degWatermark)
+        _degActive = true;
+    else if (_degActive && backlog < (uint16_t)(_degWatermark / 2))
+    {
+        if (_degSkipped > 0)
+            degEmit(0); // close the books — suppressed count must not vanish
+        _degActive = false;
+    }
+}
+
+// ── Live stats sideband (CONF:STATS) ──────────────────────────────────────────
+// Opt-in per-second telemetry frame so the host can watch back-pressure while
+// the binary stream is open (DIAG:STAT? is text and must wait for the run to
+// end).  Frame layout and rationale in config.h.
+
+static unsigned long _statsLastEmitMs = 0;
+static uint16_t _ringFillPeak = 0; // deepest backlog at drain start since last frame
+
+// Append one stats frame to the TX buffer; dropped (txDrops) if residue has
+// filled the buffer — the next frame supersedes it anyway.
+static void statsEmit()
+{
+    if (_txLen + STATS_FRAME_LEN > TX_HALF_BYTES)
+    {
+        acqStats.txDrops++;
+        return;
+    }
+    uint8_t *p = &_txBuf[_txLen];
+    // Raw counters, not acqStats.overflows — the mirror is updated after us.
+    uint32_t vals[4] = {(uint32_t)acqStats.nPoints,
+                        (uint32_t)(_overflowCnt + _overflowCnt2),
+                        (uint32_t)acqStats.txDrops, (uint32_t)acqStats.debounced};
+    p[0] = STATS_MARKER_BYTE;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        uint32_t v = vals[i];
+        p[1 + 4 * i] = (uint8_t)(v & 0xFF);
+        p[2 + 4 * i] = (uint8_t)((v >> 8) & 0xFF);
+        p[3 + 4 * i] = (uint8_t)((v >> 16) & 0xFF);
+        p[4 + 4 * i] = (uint8_t)((v >> 24) & 0xFF);
+    }
+    p[17] = (uint8_t)(_ringFillPeak & 0xFF);
+    p[18] = (uint8_t)((_ringFillPeak >> 8) & 0xFF);
+    // Dead-time classification counters — LE16, saturating at 65535 (enough
+    // to flag a bad tube mid-run; DIAG:STAT? has the full 32-bit values).
+    uint16_t sub = acqStats.subDead > 0xFFFF ? 0xFFFF : (uint16_t)acqStats.subDead;
+    uint16_t near_ = acqStats.nearDead > 0xFFFF ? 0xFFFF : (uint16_t)acqStats.nearDead;
+    p[19] = (uint8_t)(sub & 0xFF);
+    p[20] = (uint8_t)((sub >> 8) & 0xFF);
+    p[21] = (uint8_t)(near_ & 0xFF);
+    p[22] = (uint8_t)((near_ >> 8) & 0xFF);
+    p[23] = 0x55;
+    _txLen += STATS_FRAME_LEN;
+    txFlush();
+}
+
+// ── Self-test (DIAG:SELFTEST?) ────────────────────────────────────────────────
+// Characterizes this board's loss-free event-rate ceiling by driving the real
+// acquisition pipeline (ISR → ring → drain → USB) with internally generated
+// pulses.  Rates above the ceiling show up as overflows (ring full because the
+// drain stalled on USB back-pressure) or txDrops — exactly the losses a real
+// source at that rate would suffer.
+
+bool gmSelfTestTrial(uint32_t rate_hz)
+{
+    if (rate_hz == 0)
+        return false;
+
+    uint32_t events = (uint32_t)((uint64_t)rate_hz * SELFTEST_TRIAL_MS / 1000UL);
+    if (events < SELFTEST_MIN_EVENTS)
+        events = SELFTEST_MIN_EVENTS;
+    uint32_t periodTicks = (uint32_t)(1000000ULL * TICKS_PER_US / rate_hz);
+
+    gmStartAcquisition();
+    uint32_t next = liveTicks() + periodTicks;
+    for (uint32_t i = 0; i < events; i++)
+    {
+        // Busy-wait for the next slot, draining while we wait — just like the
+        // streaming loop() does between real pulses.
+        while ((int32_t)(liveTicks() - next) < 0)
+            gmProcessAcquisition();
+        gmISR(); // synthetic pulse, timestamped exactly like a real edge
+        next += periodTicks;
+    }
+    gmProcessAcquisition();
+    gmStopAcquisition();
+
+    // Clean only if every pulse left the board: the first event primes the
+    // delta tracking, each later one must have produced a packet.
+    return acqStats.overflows == 0 && acqStats.txDrops == 0 &&
+           acqStats.nPoints == events - 1;
+}
+
+uint32_t gmSelfTestSweep(GmSelfTestTrialFn trial)
+{
+    // Coarse pass: double upward until a rate fails or the cap is cleared.
+    uint32_t lastPass = 0;
+    uint32_t rate = SELFTEST_RATE_MIN_HZ;
+    while (rate <= SELFTEST_RATE_MAX_HZ)
+    {
+        if (!trial(rate))
+            break;
+        lastPass = rate;
+        rate *= 2;
+    }
+    if (lastPass == 0)
+        return 0; // even the floor rate loses events
+    if (rate > SELFTEST_RATE_MAX_HZ)
+        return lastPass; // clean all the way up to the cap
+
+    // Refine between the last pass and the first failure.  ~6 % resolution is
+    // plenty for qualification and keeps the number of trials small.
+    uint32_t lo = lastPass, hi = rate;
+    while (hi - lo > lo / 16 + 1)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (trial(mid))
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+uint32_t gmSelfTest()
+{
+    return gmSelfTestSweep(gmSelfTestTrial);
+}
+
 // Enable the DWT cycle counter.  Call once from setup().  No-op in micros() mode.
 void gmEnableHighResClock()
 {
@@ -125,15 +927,47 @@ void gmStartAcquisition()
 {
     noInterrupts();
     _readIdx = _writeIdx; // discard any accumulated pre-start pulses
-    _lastTs = 0;
+    _readIdx2 = _writeIdx2;
     _hasLastTs = false;
     _overflowCnt = 0;
+    _overflowCnt2 = 0;
     interrupts();
+    _wrapEpochBase = 0;
+    _lastRawSample = liveTicks();
+    _lastTs64 = 0;
+    if (gmState.ch2_enabled)
+    {
+        // Dual-channel runs measure both channels from the stream-start tick
+        // so the host can place their events on one shared timeline; each
+        // channel's first frame is then its offset from start.
+        _hasLastTs = true;
+        _lastTs64 = _lastRawSample;
+        _lastTs64Ch2 = _lastRawSample;
+    }
     _txLen = 0; // discard any half-built batch from a previous run
+    _txDrainLen = _txDrainRead = 0;
+    _varintCountdown = VARINT_RESYNC_INTERVAL; // start marker provides initial sync
+    _txSeq = 0; // sequence numbers restart with every stream
+    memset(_histBins, 0, sizeof(_histBins));
+    _histLastEmitMs = millis();
+    _statsLastEmitMs = millis();
+    _ringFillPeak = 0;
+    _burstLen = 0;
+    _hwStopPending = false; // a new run supersedes any unconsumed stop
+    _mcsBinStart64 = _lastRawSample; // epoch base is 0 at start
+    _mcsBinIdx = 0;
+    _mcsCount = 0;
+    rngReset();
+    _degActive = false;
+    _degSkipped = 0;
+    gmProfileReset();
 
     for (uint8_t i = 0; i < 6; i++)
         Serial.write(0xFF); // start marker consumed by host
 
+    if (gmState.sync_epoch)
+        epochEmit(); // clock pairing for host-side offset/drift fitting
+
     acqStats.reset();
     acqStats.startMs = millis();
     gmState.streaming = true;
@@ -142,9 +976,13 @@ void gmStartAcquisition()
 void gmStopAcquisition()
 {
     gmState.streaming = false;
+    // Histogram mode: emit a final snapshot so the host has the complete run
+    // even if the last 1 s emit interval had not elapsed.
+    if (gmState.acq_mode == ACQ_HIST)
+        histEmit();
     // Drain the TX buffer with retries — at stop we can afford to wait.
     // Non-blocking txFlush() may need several attempts if the host was slow.
-    for (uint8_t i = 0; i < 100 && _txLen > 0; i++)
+    for (uint8_t i = 0; i < 100 && txPending() > 0; i++)
     {
         txFlush();
         delayMicroseconds(500);
@@ -161,24 +999,51 @@ void gmResetAcquisition()
     noInterrupts();
     _writeIdx = 0;
     _readIdx = 0;
-    _lastTs = 0;
     _hasLastTs = false;
     _overflowCnt = 0;
+    _writeIdx2 = 0;
+    _readIdx2 = 0;
+    _overflowCnt2 = 0;
     interrupts();
+    _wrapEpochBase = 0;
+    _lastRawSample = liveTicks();
+    _lastTs64 = 0;
+    _lastTs64Ch2 = 0;
     _txLen = 0;
+    _txDrainLen = _txDrainRead = 0;
+    _burstLen = 0;
+    _hwStopPending = false;
+    rngReset();
+    _degActive = false;
+    _degSkipped = 0;
     acqStats.reset();
+    gmProfileReset();
 }
 
 // ── End-of-period detection ───────────────────────────────────────────────────
 
-static uint32_t _periodMs = 0; // expected period duration in ms
+static uint32_t _periodMs = 0;            // expected period duration in ms
+static unsigned long _periodStartMs = 0;  // start of the *current* period
+static uint16_t _periodIdx = 0;           // zero-based index of current period
 
 void gmArmEndOfPeriod(uint32_t period_ms)
 {
     _periodMs = period_ms;
+    _periodStartMs = millis();
+    _periodIdx = 0;
     gmState.endPeriodArmed = true;
 }
 
+// Re-arm for the next period without stopping acquisition (repeat mode).
+// Called by loop() right after the per-period sentinel has gone out, so the
+// stop/start overhead (start marker, ring reset, 9600-baud Serial1 round
+// trips) disappears from multi-period sweeps entirely.
+void gmRearmEndOfPeriod()
+{
+    _periodStartMs = millis();
+    _periodIdx++;
+}
+
 void gmDisarmEndOfPeriod()
 {
     gmState.endPeriodArmed = false;
@@ -190,7 +1055,7 @@ bool gmEndOfPeriodReached()
     if (!gmState.endPeriodArmed)
         return false;
 
-    unsigned long elapsed = millis() - acqStats.startMs;
+    unsigned long elapsed = millis() - _periodStartMs;
 
     // Timer fallback: fire if the nominal period + safety margin has elapsed
     // regardless of Serial1 activity.
@@ -198,25 +1063,61 @@ bool gmEndOfPeriodReached()
         return true;
 
     // Device-authoritative path: the GM counter sends its result count on
-    // Serial1 at the end of the counting period (e1 mode).  Guard: ignore
-    // Serial1 data arriving in the first half of the period — that window
+    // Serial1 at the end of the counting period (e1 mode).  Guard: data
+    // arriving in the first half of the period does not count — that window
     // catches the "s1" start acknowledgement the GM counter may echo back.
-    if (Serial1.available() > 0 && elapsed >= _periodMs / 2)
+    // Either way the bytes are drained: ignored bytes left in the RX buffer
+    // would satisfy this check the moment the half-period guard lifts and
+    // end the run early.
+    if (Serial1.available() > 0)
     {
-        // Drain the result line; we only need to know it arrived.
         while (Serial1.available() > 0)
             Serial1.read();
-        return true;
+        if (elapsed >= _periodMs / 2)
+            return true;
     }
 
     return false;
 }
 
+// Write the self-describing session trailer (layout in config.h) directly to
+// Serial — it follows the 0xEE sentinel, after the TX pipeline has drained.
+// acqStats.endMs is still 0 here (gmStopAcquisition runs after the marker),
+// so the duration falls back to the live clock.
+static void trailerEmit()
+{
+    uint8_t p[TRAILER_FRAME_LEN] = {0};
+    p[0] = TRAILER_MARKER_BYTE;
+    p[1] = TRAILER_FORMAT_VERSION;
+    p[2] = (uint8_t)gmState.encoding;
+    p[3] = (uint8_t)gmState.acq_mode;
+    p[4] = (uint8_t)(TICKS_PER_US & 0xFF);
+    p[5] = (uint8_t)((TICKS_PER_US >> 8) & 0xFF);
+    uint32_t durMs = (uint32_t)((acqStats.endMs != 0 ? acqStats.endMs
+                                                     : millis()) -
+                                acqStats.startMs);
+    uint32_t v[5] = {durMs, (uint32_t)acqStats.nPoints,
+                     (uint32_t)acqStats.debounced, (uint32_t)acqStats.overflows,
+                     (uint32_t)acqStats.txDrops};
+    for (uint8_t i = 0; i < 5; i++)
+        for (uint8_t b = 0; b < 4; b++)
+            p[6 + 4 * i + b] = (uint8_t)((v[i] >> (8 * b)) & 0xFF);
+    uint16_t sd = acqStats.subDead > 0xFFFF ? 0xFFFF : (uint16_t)acqStats.subDead;
+    uint16_t nd = acqStats.nearDead > 0xFFFF ? 0xFFFF : (uint16_t)acqStats.nearDead;
+    p[26] = (uint8_t)(sd & 0xFF);
+    p[27] = (uint8_t)(sd >> 8);
+    p[28] = (uint8_t)(nd & 0xFF);
+    p[29] = (uint8_t)(nd >> 8);
+    p[30] = _txSeq; // ENC_SEQ only — closes the host's final gap window
+    p[31] = 0x55;
+    Serial.write(p, TRAILER_FRAME_LEN);
+}
+
 void gmEmitEndMarker()
 {
     // Drain any pending data packets with retries so the sentinel is never
     // interleaved with a partial batch.  Same approach as gmStopAcquisition.
-    for (uint8_t i = 0; i < 100 && _txLen > 0; i++)
+    for (uint8_t i = 0; i < 100 && txPending() > 0; i++)
     {
         txFlush();
         delayMicroseconds(500);
@@ -225,56 +1126,209 @@ void gmEmitEndMarker()
     // detects this sentinel and emits a measurement_complete signal.
     for (uint8_t i = 0; i < 6; i++)
         Serial.write((uint8_t)END_MARKER_BYTE);
+    // Session trailer — opt-in (CONF:TRAIL).  The host parser stays in sync
+    // after the sentinel, so an unexpected trailer would be misframed as data;
+    // only hosts that asked for it get it.
+    if (gmState.session_trailer)
+        trailerEmit();
 }
 
-void gmProcessAcquisition()
+void gmEmitPeriodMarker()
 {
-    while (true)
+    // Same forced drain as gmEmitEndMarker — the sentinel must never land
+    // inside a partially flushed batch.
+    for (uint8_t i = 0; i < 100 && txPending() > 0; i++)
     {
-        uint32_t ts = 0;
+        txFlush();
+        delayMicroseconds(500);
+    }
+    // Framed encodings only — INIT rejects repeat mode under ENC_VARINT,
+    // where 0xEE would read as an ordinary continuation byte.
+    // [0xEE, 0xEE, 0xEE, idx LE16, 0x55] — six bytes like a data packet, and
+    // unambiguous: the end marker needs six consecutive 0xEE, this sentinel
+    // always ends in 0x55.  idx wraps at 2^16 on very long repeat runs.
+    uint8_t m[6] = {END_MARKER_BYTE, END_MARKER_BYTE, END_MARKER_BYTE,
+                    (uint8_t)(_periodIdx & 0xFF), (uint8_t)(_periodIdx >> 8),
+                    0x55};
+    Serial.write(m, 6);
+}
 
-        noInterrupts();
-        bool hasData = (_readIdx != _writeIdx);
-        if (hasData)
-        {
-            ts = _timestamps[_readIdx];
-            _readIdx = (_readIdx + 1) & RING_BUF_MASK;
-        }
-        interrupts();
+void gmProcessAcquisition()
+{
+    // Snapshot both write indices BEFORE sampling the live counter.  A pulse
+    // whose ISR fires between the time sample and the snapshot would land in
+    // this very pass with ts > nowRaw and be mistaken for a pre-wrap
+    // timestamp below — its delta would underflow and saturate, and the
+    // regressed baseline would corrupt the next delta too.  Snapshotting
+    // first proves every drained timestamp was latched no later than now64.
+    uint16_t wr = _writeIdx;
+    uint16_t wr2 = _writeIdx2;
 
-        if (!hasData)
-        {
-            txFlush(); // ring drained — send whatever is left in the batch now
+    // Wrap detection: the live counter going backwards since the last drain
+    // cycle means exactly one wrap (loop() runs ≫ once per 89.48 s).
+    uint32_t nowRaw = liveTicks();
+    if (nowRaw < _lastRawSample)
+        _wrapEpochBase += (1ULL << 32);
+    _lastRawSample = nowRaw;
+    uint64_t now64 = _wrapEpochBase + nowRaw;
 
-            // Sync ISR overflow count to stats on each drain cycle.
-            if (_overflowCnt > 0)
-            {
-                noInterrupts();
-                acqStats.overflows += _overflowCnt;
-                _overflowCnt = 0;
-                interrupts();
-            }
-            return;
-        }
+    profRecord(nowRaw);
+
+    // Block drain, no interrupt masking.  The ring is strictly single-producer
+    // (ISR) / single-consumer (here), and both indices are aligned uint16_t, so
+    // every load/store below is a single atomic access on the Cortex-M4:
+    //   - _writeIdx was snapshotted ONCE above; slots [rd, wr) are then
+    //     exclusively ours — the ISR only ever writes at or beyond wr.
+    //   - _readIdx is republished with a plain store after each pop so the
+    //     ISR's full-buffer check never sees a stale consumer position.
+    // Events arriving during this pass are picked up on the next loop() call.
+    bool burstDone = false;
+
+    uint16_t rd = _readIdx;
+
+    // High-water mark for the stats sideband: backlog depth as this pass begins.
+    uint16_t backlog = (uint16_t)((wr - rd) & RING_BUF_MASK);
+    if (backlog > _ringFillPeak)
+        _ringFillPeak = backlog;
+    if (backlog > _prof.ringPeak)
+        _prof.ringPeak = backlog;
+    degUpdate(backlog); // watermark policy decides once per pass
+
+    while (rd != wr)
+    {
+        uint32_t ts = _timestamps[rd];
+        rd = (rd + 1) & RING_BUF_MASK;
+        _readIdx = rd;
+
+        // Extend the raw 32-bit timestamp into the current epoch; a value ahead
+        // of the live counter was latched before the wrap we just counted.
+        uint64_t ts64 = _wrapEpochBase + ts;
+        if (ts64 > now64)
+            ts64 -= (1ULL << 32);
 
         if (!_hasLastTs)
         {
-            _lastTs = ts;
+            _lastTs64 = ts64;
             _hasLastTs = true;
             continue;
         }
 
-        uint32_t delta = ts - _lastTs;
-        _lastTs = ts;
+        uint64_t delta64 = ts64 - _lastTs64;
+        _lastTs64 = ts64;
+
+        // Wire format carries 32 bits — saturate instead of aliasing so a gap
+        // beyond ~89.48 s shows up as an unmistakable 0xFFFFFFFF on the host.
+        uint32_t delta = (delta64 > 0xFFFFFFFFULL) ? 0xFFFFFFFFUL
+                                                   : (uint32_t)delta64;
 
         if (delta > DEBOUNCE_TICKS)
         {
-            txAppend(delta);
-            acqStats.nPoints++;
+            if (gmState.acq_mode == ACQ_HIST)
+                histCount(delta);
+            else if (gmState.acq_mode == ACQ_BURST)
+                burstDone = burstStore(delta);
+            else if (gmState.acq_mode == ACQ_MCS)
+            {
+                mcsCatchUp(ts64); // close bins the event skipped over
+                _mcsCount++;
+            }
+            else if (gmState.acq_mode == ACQ_RNG)
+                rngFeed(delta);
+            else if (_degActive)
+                degFeed(delta); // watermark crossed — decimated summary frames
+            else
+                txAppend(delta);
+            acqStats.addDelta(delta);
+            deadtimeClassify(delta);
         }
         else
         {
             acqStats.debounced++;
         }
     }
+
+    // Channel 2 (CONF:CH2): same drain pattern against its own ring.  Both
+    // baselines were seeded with the stream-start tick, so every accepted
+    // event — including each channel's first — produces a tagged frame.
+    if (gmState.ch2_enabled)
+    {
+        uint16_t rd2 = _readIdx2; // wr2 snapshotted with wr, before now64
+        while (rd2 != wr2)
+        {
+            uint32_t ts = _timestamps2[rd2];
+            rd2 = (rd2 + 1) & RING2_BUF_MASK;
+            _readIdx2 = rd2;
+
+            uint64_t ts64 = _wrapEpochBase + ts;
+            if (ts64 > now64)
+                ts64 -= (1ULL << 32);
+
+            uint64_t delta64 = ts64 - _lastTs64Ch2;
+            _lastTs64Ch2 = ts64;
+
+            uint32_t delta = (delta64 > 0xFFFFFFFFULL) ? 0xFFFFFFFFUL
+                                                       : (uint32_t)delta64;
+
+            if (delta > DEBOUNCE_TICKS)
+            {
+                txAppendCh2(delta);
+                acqStats.addDelta(delta);
+                deadtimeClassify(delta);
+            }
+            else
+            {
+                acqStats.debounced++;
+            }
+        }
+    }
+
+    // Burst capture complete: stream the array out, then finish the run like a
+    // normal end of period so the host parser sees the usual 0xEE sentinel.
+    // The hardware side of the stop (s0/e0) cannot happen here — the Serial1
+    // TX queue lives in the SCPI layer — so it is flagged for loop() to send;
+    // end-of-period state is disarmed now, or its stale timer would fire on
+    // the next infinite-time run.
+    if (burstDone && gmState.streaming)
+    {
+        acqStats.overflows = _overflowCnt + _overflowCnt2;
+        burstPlayback();
+        gmEmitEndMarker();
+        gmStopAcquisition();
+        gmDisarmEndOfPeriod();
+        _hwStopPending = true;
+        return;
+    }
+
+    // Histogram mode: time-based snapshot emission, checked once per
+    // drain cycle (the ring drains to empty quickly at any rate).
+    if (gmState.acq_mode == ACQ_HIST && gmState.streaming &&
+        millis() - _histLastEmitMs >= HIST_EMIT_INTERVAL_MS)
+    {
+        histEmit();
+        _histLastEmitMs = millis();
+    }
+
+    // MCS mode: close bins on live ticks as well, so a quiet source still
+    // produces its (empty) bin frames on time.
+    if (gmState.acq_mode == ACQ_MCS && gmState.streaming)
+        mcsCatchUp(now64);
+
+    // Stats sideband: same per-second cadence, valid in either acquisition mode.
+    if (gmState.stats_sideband && gmState.streaming &&
+        millis() - _statsLastEmitMs >= STATS_EMIT_INTERVAL_MS)
+    {
+        statsEmit();
+        _statsLastEmitMs = millis();
+        _ringFillPeak = 0;
+    }
+
+    // Rate-adaptive flush: a full batch flushed already (txAppend); anything
+    // less is held at most TX_FLUSH_DEADLINE_MS, bounding the live-display
+    // latency at low rates without giving up coalescing at high ones.
+    if (txPending() > 0 && millis() - _txFirstHeldMs >= TX_FLUSH_DEADLINE_MS)
+        txFlush();
+
+    // Mirror the ISR's run-cumulative overflow counter into the stats (pure
+    // atomic read — the counter is only zeroed at start/reset, never here).
+    acqStats.overflows = _overflowCnt + _overflowCnt2;
 }
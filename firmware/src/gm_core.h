@@ -7,9 +7,18 @@
 // No-op when USE_CYCLE_COUNTER == 0 (native unit tests use micros()).
 void gmEnableHighResClock();
 
+// Configure GPT channel 1 input capture on D2/P105 — hardware-latched timestamps
+// (docs/TIMING_AND_GPT_TIMER.md, Approach C).  Call from setup() AFTER
+// attachInterrupt().  No-op unless built with -DUSE_GPT_CAPTURE=1.
+void gmEnableInputCapture();
+
 // ISR — attach to INTERRUPT_PIN on RISING edge.
 void gmISR();
 
+// Channel-2 ISR — attach to INTERRUPT2_PIN on RISING edge.  Feeds its own
+// ring; drained only while CONF:CH2 is enabled.
+void gmISR2();
+
 // Reset ring buffer and send the 0xFF×6 start marker, then set streaming=true.
 void gmStartAcquisition();
 
@@ -23,6 +32,102 @@ void gmProcessAcquisition();
 // Reset ring buffer and last-timestamp — called by *RST and in tests between cases.
 void gmResetAcquisition();
 
+// ── On-device histogram (ACQ_HIST mode) ──────────────────────────────────────
+
+// Set the binning scheme: linear bins of *width_ticks* (HIST_LIN_BINS of them)
+// or, when linear == false, 32 log2-spaced bins (width_ticks then unused; pass 0
+// to keep the previous width).  Called by CONF:HIST.
+void gmConfigureHistogram(bool linear, uint32_t width_ticks);
+
+// Current binning config — used by the CONF:HIST? query.
+bool gmHistogramIsLinear();
+uint32_t gmHistogramWidthTicks();
+
+// ── MCS interval counting (ACQ_MCS mode) ─────────────────────────────────────
+
+// Set the counts-per-bin width (CONF:ACQ MCS,<width_us>); 0 keeps the previous
+// width.  The current width is readable for queries and tests.
+void gmConfigureMcs(uint32_t width_us);
+uint32_t gmMcsWidthUs();
+
+// ── RNG entropy extraction (ACQ_RNG mode) ────────────────────────────────────
+
+// Select the debiaser (RNG_VN or RNG_PARITY, config.h); set by CONF:ACQ
+// RNG,VN|PAR.  The current method is readable for queries and tests.
+void gmConfigureRng(uint8_t method);
+uint8_t gmRngMethod();
+
+// ── Burst capture (ACQ_BURST mode) ───────────────────────────────────────────
+
+// Set the number of deltas captured before playback starts (0 or out-of-range
+// values clamp to BURST_BUF_SIZE).  Called by CONF:ACQ BURST,<n>.
+void gmConfigureBurst(uint32_t n_events);
+uint32_t gmBurstTarget();
+
+// True exactly once after a burst run stopped itself (target reached).  The
+// caller — loop() — must then send s0/e0 to the GM counter, like every other
+// stop; gm_core cannot do that itself, the Serial1 TX queue lives in the
+// SCPI layer.
+bool gmTakeHwStopPending();
+
+// ── Ring watermark degradation (CONF:WMARK) ──────────────────────────────────
+
+// Set the ring-backlog high watermark in events (0 disables the policy);
+// CONF:WMARK.  gmDegradeActive() reports whether the stream is currently
+// degraded — for queries and tests.
+void gmConfigureWatermark(uint16_t events);
+uint16_t gmWatermark();
+bool gmDegradeActive();
+
+// ── Dead-time classification (CONF:DEAD) ─────────────────────────────────────
+
+// Set the tube dead time in µs for the drain-path classifier (CONF:DEAD);
+// 0 keeps the previous value.  The current value is readable for queries.
+void gmConfigureDeadtime(uint32_t us);
+uint32_t gmDeadtimeUs();
+
+// ── Clock-sync epoch (CONF:SYNC / SYST:SYNC?) ────────────────────────────────
+
+// Sample the high-res tick counter and millisecond clock as one pair — the
+// payload of both the 0xAD epoch packet and the SYST:SYNC? query.
+void gmClockSample(uint32_t &ticks, uint32_t &ms);
+
+// ── Drain-cycle profiler (DIAG:PROF?) ────────────────────────────────────────
+
+// Accumulated inside gmProcessAcquisition() while streaming; reset on every
+// start (and by *RST).  All updates are O(1) per drain pass.
+struct GmProfile
+{
+    uint32_t bins[PROF_BINS]; // bins[i] = drain gaps in [2^i, 2^(i+1)) µs
+    uint32_t maxGapUs;        // longest observed gap between drain passes
+    uint16_t ringPeak;        // ring-occupancy high-water mark (whole run)
+    uint16_t txLenPeak;       // _txBuf fill high-water mark at flush time
+};
+
+// Read-only view of the accumulated profile — used by the DIAG:PROF? query.
+const GmProfile &gmProfile();
+void gmProfileReset();
+
+// ── Self-test (DIAG:SELFTEST?) ───────────────────────────────────────────────
+
+// Run one trial at *rate_hz*: generate SELFTEST_TRIAL_MS worth of synthetic
+// pulses through the normal ISR/ring/TX pipeline, paced by the live tick
+// counter.  Returns true if every event made it out (no overflows, no
+// txDrops, no debounce losses).  Emits a normal binary stream (start marker,
+// packets) — the host must discard it.  Hardware only: the pacing loop
+// busy-waits on real time and would never terminate under the mocked clock.
+bool gmSelfTestTrial(uint32_t rate_hz);
+
+// Sweep *trial* upward from SELFTEST_RATE_MIN_HZ (doubling, then a binary
+// search between the last pass and the first failure) and return the highest
+// passing rate in events/s — 0 if even the floor rate loses events.  The
+// trial function is a parameter so the sweep logic is testable natively.
+typedef bool (*GmSelfTestTrialFn)(uint32_t rate_hz);
+uint32_t gmSelfTestSweep(GmSelfTestTrialFn trial);
+
+// gmSelfTestSweep(gmSelfTestTrial) — the DIAG:SELFTEST? entry point.
+uint32_t gmSelfTest();
+
 // ── End-of-period detection (e1 mode) ────────────────────────────────────────
 
 // Arm end-of-period detection for a measurement of *period_ms* milliseconds.
@@ -33,6 +138,10 @@ void gmArmEndOfPeriod(uint32_t period_ms);
 // Disarm end-of-period detection (called by ABOR, *RST).
 void gmDisarmEndOfPeriod();
 
+// Re-arm for the next period without stopping acquisition — repeat mode only.
+// Resets the period timer and advances the period index.
+void gmRearmEndOfPeriod();
+
 // Returns true when the end of the counting period has been detected.
 // Detection conditions (either suffices):
 //   1. Serial1 carries data AND at least half the period has elapsed
@@ -44,6 +153,14 @@ void gmDisarmEndOfPeriod();
 bool gmEndOfPeriodReached();
 
 // Flush any pending TX data, then write 6 × 0xEE to Serial as the
-// end-of-period sentinel; the host PacketParser detects this marker and
-// emits a measurement_complete signal to AppController.
+// end-of-period sentinel — followed, when CONF:TRAIL is enabled, by the
+// self-describing session trailer (0xB1 frame, layout in config.h); the host
+// PacketParser detects the sentinel and emits a measurement_complete signal
+// to AppController.
 void gmEmitEndMarker();
+
+// Flush pending TX data, then write the per-period sentinel
+// [0xEE, 0xEE, 0xEE, period_idx LE16, 0x55] marking one completed period
+// inside a continuing repeat-mode stream.  Cannot alias the end marker:
+// the final byte is 0x55, never 0xEE.
+void gmEmitPeriodMarker();
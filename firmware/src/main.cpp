@@ -1,61 +1,103 @@
 #include <Arduino.h>
+#include <string.h>
 #include "config.h"
 #include "state.h"
 #include "gm_core.h"
 #include "scpi.h"
 
-static String inputBuf;
-
 // Maximum number of characters accepted before a newline.
 // Longest valid command is well under 64 chars (e.g. "CONF:VOLT 700" = 13).
 static const uint8_t CMD_MAX_LEN = 63;
 
+// Fixed line buffer — the input path never allocates (see scpi.cpp).
+static char inputBuf[CMD_MAX_LEN + 1];
+static uint8_t inputLen = 0;
+
 void setup()
 {
     Serial.begin(USB_BAUD_RATE);
     Serial1.begin(GM_BAUD_RATE);
 
-    inputBuf.reserve(CMD_MAX_LEN);
-
     gmEnableHighResClock(); // start the DWT cycle counter (high-res timestamps)
 
     pinMode(INTERRUPT_PIN, INPUT);
     attachInterrupt(digitalPinToInterrupt(INTERRUPT_PIN), gmISR, RISING);
+    gmEnableInputCapture(); // after attachInterrupt — preserves the pin-IRQ mux
+
+    // Second capture channel (CONF:CH2).  Always attached; the ring is only
+    // drained while CH2 is enabled, and stale pulses are discarded at start.
+    pinMode(INTERRUPT2_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(INTERRUPT2_PIN), gmISR2, RISING);
 }
 
 static void appendChar(char c)
 {
-    if (inputBuf.length() < CMD_MAX_LEN)
+    if (inputLen < CMD_MAX_LEN)
     {
-        inputBuf += c;
+        inputBuf[inputLen++] = c;
     }
     else
     {
         // Line too long — discard buffer and report.
-        inputBuf = "";
+        inputLen = 0;
         errorQueue.push("-150,\"String data error; line too long\"");
     }
 }
 
+// Terminate the accumulated line, reset the buffer, and return the command
+// with leading/trailing whitespace trimmed (in place — no copies).
+static const char *finishLine()
+{
+    inputBuf[inputLen] = '\0';
+    inputLen = 0;
+    char *s = inputBuf;
+    while (*s == ' ' || *s == '\t')
+        s++;
+    char *e = s + strlen(s);
+    while (e > s && (e[-1] == ' ' || e[-1] == '\t'))
+        *--e = '\0';
+    return s;
+}
+
 void loop()
 {
     if (gmState.streaming)
     {
         // ── Fast path: drain ring buffer and send binary packets ──────────────
         gmProcessAcquisition();
+        scpiSerial1Service(); // drain queued GM counter lines without blocking
+
+        // A burst run stops itself inside gmProcessAcquisition(); finish the
+        // hardware side of the stop here like any other end of run.
+        if (gmTakeHwStopPending())
+        {
+            scpiSerial1Enqueue("s0");
+            scpiSerial1Enqueue("e0");
+            return;
+        }
 
         // End-of-period detection: check after draining so all in-flight packets
         // are sent before the sentinel.  gmEndOfPeriodReached() returns true only
         // when gmState.endPeriodArmed is set (finite time, non-repeat measurements).
         if (gmEndOfPeriodReached())
         {
-            gmEmitEndMarker();
-            gmStopAcquisition();
-            Serial1.println("s0");
-            Serial1.println("e0");
-            gmDisarmEndOfPeriod();
-            // Fall through to normal idle SCPI processing on the next loop().
-            return;
+            if (gmState.repeat)
+            {
+                // Repeat mode: mark the period boundary in-stream and keep
+                // going — no stop/start, no ring reset, no Serial1 round trips.
+                gmEmitPeriodMarker();
+                gmRearmEndOfPeriod();
+            }
+            else
+            {
+                gmEmitEndMarker();
+                gmStopAcquisition();
+                scpiSerial1Enqueue("s0");
+                scpiSerial1Enqueue("e0");
+                gmDisarmEndOfPeriod();
+                // Fall through to normal idle SCPI processing on the next loop().
+                return;
+            }
         }
 
         // Only ABOR or *RST accepted during streaming.
@@ -63,19 +105,21 @@ void loop()
         while (Serial.available() > 0)
         {
             char c = (char)Serial.read();
+            if (scpiFastByte((uint8_t)c))
+                continue; // binary opcode — OP_ABOR works, the rest push -213
             if (c == '\n')
             {
-                inputBuf.trim();
-                String h, p;
+                const char *cmd = finishLine();
+                char h[SCPI_MAX_HEADER], p[SCPI_MAX_PARAM];
                 bool q;
-                if (scpiParse(inputBuf, h, p, q))
+                if (scpiParse(cmd, h, p, q))
                 {
-                    if (!q && (h == "ABOR" || h == "ABORT" || h == "*RST"))
-                        scpiDispatch(inputBuf);
+                    if (!q && (strcmp(h, "ABOR") == 0 || strcmp(h, "ABORT") == 0 ||
+                               strcmp(h, "*RST") == 0))
+                        scpiDispatch(cmd);
                     else
                         errorQueue.push("-213,\"Init ignored; streaming is active\"");
                 }
-                inputBuf = "";
             }
             else if (c != '\r')
             {
@@ -96,19 +140,19 @@ void loop()
             char c = (char)Serial.read();
             if (c == '\n')
             {
-                inputBuf.trim();
-                String h, p;
+                const char *cmd = finishLine();
+                char h[SCPI_MAX_HEADER], p[SCPI_MAX_PARAM];
                 bool q;
-                if (scpiParse(inputBuf, h, p, q))
+                if (scpiParse(cmd, h, p, q))
                 {
-                    if (!q && (h == "DIAG:PASS" || h == "DIAGNOSTIC:PASSTHROUGH"))
-                        scpiDispatch(inputBuf); // toggles passthrough off
-                    else if (!q && (h == "ABOR" || h == "ABORT"))
-                        scpiDispatch(inputBuf);
+                    if (!q && (strcmp(h, "DIAG:PASS") == 0 ||
+                               strcmp(h, "DIAGNOSTIC:PASSTHROUGH") == 0))
+                        scpiDispatch(cmd); // toggles passthrough off
+                    else if (!q && (strcmp(h, "ABOR") == 0 || strcmp(h, "ABORT") == 0))
+                        scpiDispatch(cmd);
                     else
-                        Serial1.println(inputBuf); // forward raw to GM counter
+                        Serial1.println(cmd); // forward raw to GM counter
                 }
-                inputBuf = "";
             }
             else if (c != '\r')
             {
@@ -120,12 +164,16 @@ void loop()
     {
         // ── Idle path: full SCPI command processing ───────────────────────────
 
+        scpiService();        // pump the asynchronous FETC:STAT? reply assembly
+        scpiSerial1Service(); // drain queued GM counter lines without blocking
+
         // The GM counter boots into continuous-stream mode (b4). If it sends
         // unsolicited data and the user has not explicitly configured stream_mode 4,
-        // suppress it immediately and drain the stale bytes.
-        if (Serial1.available() > 0 && gmState.stream_mode != 4)
+        // suppress it immediately and drain the stale bytes.  Not while a fetch
+        // is pending — those Serial1 bytes are the b2 reply being assembled.
+        if (!scpiFetchPending() && Serial1.available() > 0 && gmState.stream_mode != 4)
         {
-            Serial1.println("b0");
+            scpiSerial1Enqueue("b0");
             while (Serial1.available() > 0)
                 Serial1.read();
         }
@@ -133,11 +181,11 @@ void loop()
         while (Serial.available() > 0)
         {
             char c = (char)Serial.read();
+            if (scpiFastByte((uint8_t)c))
+                continue; // binary opcode — handled without line accumulation
             if (c == '\n')
             {
-                inputBuf.trim();
-                scpiDispatch(inputBuf);
-                inputBuf = "";
+                scpiDispatch(finishLine());
             }
             else if (c != '\r')
             {
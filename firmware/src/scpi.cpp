@@ -1,32 +1,61 @@
 #include "scpi.h"
 #include "gm_core.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <ctype.h>
+
+// The whole pipeline works on fixed char buffers — no Arduino String, so a
+// multi-hour FETC:STAT? polling session performs zero heap allocations and
+// cannot fragment the RA4M1's 32 KB SRAM.
+
+static inline bool streq(const char *a, const char *b)
+{
+    return strcmp(a, b) == 0;
+}
 
 // ── Parser ────────────────────────────────────────────────────────────────────
 
-bool scpiParse(const String &line, String &header, String &param, bool &isQuery)
+bool scpiParse(const char *line, char *header, char *param, bool &isQuery)
 {
-    if (line.length() == 0)
+    if (line == nullptr || line[0] == '\0')
         return false;
 
-    int sp = line.indexOf(' ');
-    if (sp >= 0)
+    const char *sp = strchr(line, ' ');
+    size_t hlen = sp ? (size_t)(sp - line) : strlen(line);
+    if (hlen >= SCPI_MAX_HEADER)
+        hlen = SCPI_MAX_HEADER - 1;
+    memcpy(header, line, hlen);
+    header[hlen] = '\0';
+
+    if (sp)
     {
-        header = line.substring(0, sp);
-        param = line.substring(sp + 1);
-        param.trim();
+        // Skip spaces between header and param, then copy and right-trim.
+        while (*sp == ' ')
+            sp++;
+        size_t plen = strlen(sp);
+        if (plen >= SCPI_MAX_PARAM)
+            plen = SCPI_MAX_PARAM - 1;
+        memcpy(param, sp, plen);
+        while (plen > 0 && (param[plen - 1] == ' ' || param[plen - 1] == '\t'))
+            plen--;
+        param[plen] = '\0';
     }
     else
     {
-        header = line;
-        param = "";
+        param[0] = '\0';
     }
 
-    isQuery = header.endsWith("?");
+    size_t end = strlen(header);
+    isQuery = (end > 0 && header[end - 1] == '?');
     if (isQuery)
-        header = header.substring(0, header.length() - 1);
+        header[end - 1] = '\0';
 
-    header.toUpperCase();
-    param.toUpperCase();
+    for (char *c = header; *c; c++)
+        *c = (char)toupper((unsigned char)*c);
+    for (char *c = param; *c; c++)
+        *c = (char)toupper((unsigned char)*c);
     return true;
 }
 
@@ -34,105 +63,301 @@ bool scpiParse(const String &line, String &header, String &param, bool &isQuery)
 // Names reflect the nature of the header, not the violation:
 //   errNotQueryable  — header is command-only; a query form was sent
 //   errNotACommand   — header is query-only;   a command form was sent
+// All messages are assembled with snprintf into stack buffers — no heap.
 
-static void errUndefined(const String &h)
+static void errUndefined(const char *h)
 {
-    errorQueue.push("-113,\"Undefined header; " + h + "\"");
+    char msg[64];
+    snprintf(msg, sizeof(msg), "-113,\"Undefined header; %s\"", h);
+    errorQueue.push(msg);
 }
 // Header is query-only — host sent a command form.
-static void errNotACommand(const String &h)
+static void errNotACommand(const char *h)
 {
-    errorQueue.push("-113,\"Undefined header; " + h + " is query-only\"");
+    char msg[64];
+    snprintf(msg, sizeof(msg), "-113,\"Undefined header; %s is query-only\"", h);
+    errorQueue.push(msg);
 }
 // Header is command-only — host sent a query form.
-static void errNotQueryable(const String &h)
+static void errNotQueryable(const char *h)
 {
-    errorQueue.push("-113,\"Undefined header; " + h + " is command-only\"");
+    char msg[64];
+    snprintf(msg, sizeof(msg), "-113,\"Undefined header; %s is command-only\"", h);
+    errorQueue.push(msg);
 }
-static void errParam(const String &detail)
+// printf-style detail, e.g. errParam("voltage must be %d..%d V", lo, hi).
+static void errParam(const char *fmt, ...)
 {
-    errorQueue.push("-102,\"Parameter out of range; " + detail + "\"");
+    char msg[80];
+    int n = snprintf(msg, sizeof(msg), "-102,\"Parameter out of range; ");
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(msg + n, sizeof(msg) - (size_t)n - 1, fmt, ap);
+    va_end(ap);
+    size_t len = strlen(msg);
+    msg[len] = '"';
+    msg[len + 1] = '\0';
+    errorQueue.push(msg);
+}
+
+// ── Serial1 TX queue ──────────────────────────────────────────────────────────
+// Non-blocking writes to the GM counter link; rationale and sizing in config.h.
+
+static char _s1txMsgs[S1TX_QUEUE_SIZE][S1TX_MSG_LEN];
+static uint8_t _s1txHead = 0;
+static uint8_t _s1txCount = 0;
+
+void scpiSerial1Service()
+{
+    while (_s1txCount > 0)
+    {
+        const char *line = _s1txMsgs[_s1txHead];
+        // +2 for the CRLF println() appends — all or nothing, never block.
+        if (Serial1.availableForWrite() < (int)strlen(line) + 2)
+            return; // UART full — retry on the next loop() pass
+        Serial1.println(line);
+        _s1txHead = (uint8_t)((_s1txHead + 1) % S1TX_QUEUE_SIZE);
+        --_s1txCount;
+    }
+}
+
+void scpiSerial1Enqueue(const char *line)
+{
+    if (_s1txCount >= S1TX_QUEUE_SIZE)
+    {
+        // Queue full — force the oldest line out synchronously.  Bounded to
+        // one line, and only reachable when a command burst outruns the UART;
+        // dropping would desync gmState from the hardware.
+        Serial1.println(_s1txMsgs[_s1txHead]);
+        _s1txHead = (uint8_t)((_s1txHead + 1) % S1TX_QUEUE_SIZE);
+        --_s1txCount;
+    }
+    uint8_t slot = (uint8_t)((_s1txHead + _s1txCount) % S1TX_QUEUE_SIZE);
+    snprintf(_s1txMsgs[slot], S1TX_MSG_LEN, "%s", line);
+    _s1txCount++;
+    scpiSerial1Service(); // opportunistic drain — usually sends immediately
+}
+
+// ── Serial1 hardware-state cache ──────────────────────────────────────────────
+// The one-letter configuration commands are idempotent on the GM counter, and
+// at 9600 baud each line costs ~10 ms of transmit time.  Sweep scripts re-send
+// CONF:VOLT / CONF:TIME before most points even when nothing changed, so
+// serial1Cmd() remembers the last value written per cached letter and elides
+// writes the hardware already has.  HW_UNKNOWN marks "never written since
+// boot" (or since invalidation) and always forces the write.
+//
+// Only letters that set idempotent level state are cached.  'b' is not: per
+// docs/hardware/gm-counter-protocol.rst the b2/b3 values are one-shot send
+// triggers, so eliding a repeated write would swallow the trigger (e.g.
+// FETC:STAT?'s b2 request would never reach the counter).
+
+#define HW_UNKNOWN -1
+
+static int _hwVoltage = HW_UNKNOWN;  // 'j'
+static int _hwTimeMode = HW_UNKNOWN; // 'f'
+static int _hwRepeat = HW_UNKNOWN;   // 'o'
+
+static int *hwCacheFor(char letter)
+{
+    switch (letter)
+    {
+    case 'j':
+        return &_hwVoltage;
+    case 'f':
+        return &_hwTimeMode;
+    case 'o':
+        return &_hwRepeat;
+    default:
+        return nullptr; // 'b', 'w', 'U', … — uncached, always written
+    }
+}
+
+// Forget everything the cache knows, so every cached letter is re-sent on its
+// next write.  Called when the hardware may have changed behind our back:
+// *RST (defensive full re-apply) and DIAG:PASS (raw host lines go straight to
+// the GM counter while passthrough is on).
+void scpiHwCacheInvalidate()
+{
+    _hwVoltage = _hwTimeMode = _hwRepeat = HW_UNKNOWN;
+}
+
+// True once voltage, time mode and repeat have all been written at least
+// once — the precondition INIT:FAST relies on.  One *RST primes all three
+// (it re-applies the defaults).
+static bool hwCachePrimed()
+{
+    return _hwVoltage != HW_UNKNOWN && _hwTimeMode != HW_UNKNOWN &&
+           _hwRepeat != HW_UNKNOWN;
+}
+
+// Format-and-send helper for the one-letter GM counter commands ("j500", "f2").
+// Cached letters are only written when the value actually changes.
+static void serial1Cmd(char letter, int value)
+{
+    int *cached = hwCacheFor(letter);
+    if (cached != nullptr)
+    {
+        if (*cached == value)
+            return; // hardware already has this value — save the round trip
+        *cached = value;
+    }
+    char cmd[S1TX_MSG_LEN];
+    snprintf(cmd, sizeof(cmd), "%c%d", letter, value);
+    scpiSerial1Enqueue(cmd);
 }
 
 // ── IEEE 488.2 common commands ────────────────────────────────────────────────
 
-static void handleIDN()
+static void handleIDN(const char *, bool)
 {
     Serial.println(DEVICE_MFR "," DEVICE_MODEL "," DEVICE_SERIAL "," FW_VERSION);
 }
 
-static void handleRST()
+static void handleRST(const char *, bool)
 {
     if (gmState.streaming)
     {
         gmStopAcquisition();
-        Serial1.println("s0");
-        Serial1.println("e0");
+        scpiSerial1Enqueue("s0");
+        scpiSerial1Enqueue("e0");
         gmDisarmEndOfPeriod();
     }
     gmState = GmState{};
     // Re-apply all defaults to the GM counter hardware so it matches gmState.
-    Serial1.println("j" + String(DEFAULT_VOLTAGE));
-    Serial1.println("f" + String(DEFAULT_TIME_MODE));
-    Serial1.println("o" + String(DEFAULT_REPEAT));
-    Serial1.println("b" + String(DEFAULT_STREAM_MODE));
+    // The cache is dropped first: *RST is the recovery command, so it must
+    // really write, even if the cache believes the defaults are applied.
+    scpiHwCacheInvalidate();
+    serial1Cmd('j', DEFAULT_VOLTAGE);
+    serial1Cmd('f', DEFAULT_TIME_MODE);
+    serial1Cmd('o', DEFAULT_REPEAT);
+    serial1Cmd('b', DEFAULT_STREAM_MODE);
     errorQueue.clear();
     gmResetAcquisition(); // also resets acqStats
 }
 
-static void handleCLS() { errorQueue.clear(); }
+static void handleCLS(const char *, bool) { errorQueue.clear(); }
 
-static void handleTST() { Serial.println(0); }
+static void handleTST(const char *, bool) { Serial.println(0); }
 
-static void handleOPCQ() { Serial.println(1); }
+static void handleOPCQ(const char *, bool) { Serial.println(1); }
 
 // ── SYSTem subsystem ──────────────────────────────────────────────────────────
 
-static void handleSYSTERR()
+static void handleSYSTERR(const char *, bool)
 {
     Serial.println(errorQueue.pop());
 }
 
 // Clear the GM counter's event count register.
-static void handleSYSTCLR()
+static void handleSYSTCLR(const char *, bool)
 {
-    Serial1.println("w");
+    scpiSerial1Enqueue("w");
 }
 
-static void handleSYSTDEB(const String &param, bool isQuery)
+static void handleSYSTDEB(const char *param, bool isQuery)
 {
     if (isQuery)
     {
         Serial.println(gmState.debug ? "1" : "0");
         return;
     }
-    gmState.debug = (param == "ON" || param == "1");
+    gmState.debug = (streq(param, "ON") || streq(param, "1"));
+}
+
+// SCPI 1999 mandatory
+// Clock pair for host-side offset/drift fitting: "ticks,millis".  Deliberately
+// cheap — the host timestamps the query's send and receive and brackets the
+// device sample between them; repeat over a session to estimate drift.
+static void handleSYSTSYNC(const char *, bool)
+{
+    uint32_t ticks, ms;
+    gmClockSample(ticks, ms);
+    char resp[32];
+    snprintf(resp, sizeof(resp), "%lu,%lu", (unsigned long)ticks,
+             (unsigned long)ms);
+    Serial.println(resp);
+}
+
+static void handleSYSTVERS(const char *, bool)
+{
+    Serial.println("1999.0");
+}
+
+// Re-open the GM counter link at a new rate.  The link has no acks, so there
+// is no probe handshake: the operator selects a rate the tube electronics
+// board is configured for, and a mismatch simply garbles subsequent lines
+// (recoverable with SYST:BAUD 9600).  Queued lines drain at the old rate
+// first so nothing straddles the switch.
+static long _s1Baud = GM_BAUD_RATE;
+
+static void handleSYSTBAUD(const char *param, bool isQuery)
+{
+    if (isQuery)
+    {
+        Serial.println(_s1Baud);
+        return;
+    }
+    long val = atol(param);
+    if (val != 9600 && val != 19200 && val != 38400 && val != 57600 &&
+        val != 115200)
+    {
+        errParam("baud must be 9600|19200|38400|57600|115200");
+        return;
+    }
+    while (_s1txCount > 0)
+        scpiSerial1Service(); // blocking here is fine — rare, explicit command
+    Serial1.flush();
+    Serial1.begin((unsigned long)val);
+    _s1Baud = val;
 }
 
 // ── INITiate / ABORt ──────────────────────────────────────────────────────────
 
-static void handleINIT()
+static void handleINIT(const char *, bool)
 {
     if (gmState.streaming)
     {
         errorQueue.push("-213,\"INIT ignored; acquisition already running\"");
         return;
     }
+    // An asynchronous FETC:STAT? reply may still be in flight on Serial1:
+    // scpiService() is only pumped on the idle path, so starting now would
+    // strand the reply bytes mid-stream — where they satisfy the
+    // device-authoritative end-of-period trigger at the half-period mark and
+    // end a finite run early — and the b1 stream-mode restore in
+    // fetchFinish() would never go out.
+    if (scpiFetchPending())
+    {
+        errorQueue.push("-221,\"Settings conflict; FETC:STAT? reply pending\"");
+        return;
+    }
 
-    // Arm end-of-period detection when a finite counting time is configured
-    // AND repeat mode is off.  In repeat mode the GM counter restarts itself
-    // indefinitely, so the e1 event would fire only at the first period end
-    // and leave subsequent periods undetected — disable e1 for repeat mode.
+    // Arm end-of-period detection whenever a finite counting time is
+    // configured.  With repeat off, the first period end stops the run.  With
+    // repeat on, loop() emits a per-period sentinel and re-arms instead, so
+    // the stream continues across period boundaries; even if the GM counter's
+    // e1 event fires only once, the millis() fallback in
+    // gmEndOfPeriodReached() re-triggers every re-armed period.
     unsigned long period_ms = gmCountingPeriodMs(gmState.counting_time_mode);
-    bool arm_eop = (period_ms > 0 && !gmState.repeat);
+    bool arm_eop = (period_ms > 0);
+
+    // Repeat mode injects per-period [0xEE×3, idx, 0x55] sentinels into the
+    // stream, and only a framed encoding can tell those from data: 0xEE is a
+    // valid varint continuation byte, so nothing makes the 3×0xEE prefix
+    // unrepresentable in a varint delta sequence.
+    if (arm_eop && gmState.repeat && gmState.encoding == ENC_VARINT)
+    {
+        errorQueue.push("-221,\"Settings conflict; repeat mode needs a framed encoding\"");
+        return;
+    }
 
-    Serial1.println("s1");
+    scpiSerial1Enqueue("s1");
     gmStartAcquisition();
 
     if (arm_eop)
     {
         // Enable e1: GM counter sends result on Serial1 when period ends.
-        Serial1.println("e1");
+        scpiSerial1Enqueue("e1");
         // Drain anything already in the Serial1 receive buffer — the GM
         // counter may echo the command or send an ack; we only want data
         // that arrives *after* the measurement starts to be treated as the
@@ -143,369 +368,770 @@ static void handleINIT()
     }
     else
     {
-        // Disable auto-send; host uses ABOR or wall-clock to stop.
-        Serial1.println("e0");
+        // Disable auto-send; host uses ABOR or wall-clock to stop.  Disarm
+        // defensively too: stale end-of-period state from an earlier run
+        // would otherwise fire the timer fallback into this infinite run.
+        scpiSerial1Enqueue("e0");
+        gmDisarmEndOfPeriod();
     }
 }
 
-static void handleABOR()
+// INIT:FAST — start without any Serial1 configuration round trips beyond the
+// s1 itself.  Assumes a prior INIT/CONF sequence (or *RST) already put the GM
+// counter in the desired state, which a sweep loop guarantees: only the s1
+// line is sent, the e1/e0 write and its ack drain are skipped.  End-of-period
+// detection is still armed for finite counting times; if the counter's e-mode
+// is off it triggers via the millis() fallback in gmEndOfPeriodReached()
+// (period + margin).  Saves two ~10 ms line times per sweep point.
+static void handleINITFAST(const char *, bool)
+{
+    if (gmState.streaming)
+    {
+        errorQueue.push("-213,\"INIT ignored; acquisition already running\"");
+        return;
+    }
+    if (!hwCachePrimed())
+    {
+        errorQueue.push("-221,\"Settings conflict; no prior configuration, use INIT\"");
+        return;
+    }
+    // Same in-flight-reply guard as INIT — see handleINIT.
+    if (scpiFetchPending())
+    {
+        errorQueue.push("-221,\"Settings conflict; FETC:STAT? reply pending\"");
+        return;
+    }
+
+    unsigned long period_ms = gmCountingPeriodMs(gmState.counting_time_mode);
+    // Same sentinel-ambiguity guard as INIT — see handleINIT.
+    if (period_ms > 0 && gmState.repeat && gmState.encoding == ENC_VARINT)
+    {
+        errorQueue.push("-221,\"Settings conflict; repeat mode needs a framed encoding\"");
+        return;
+    }
+    scpiSerial1Enqueue("s1");
+    gmStartAcquisition();
+    if (period_ms > 0)
+        gmArmEndOfPeriod(period_ms);
+}
+
+static void handleABOR(const char *, bool)
 {
     if (!gmState.streaming)
         return;
     gmStopAcquisition();
-    Serial1.println("s0");
-    Serial1.println("e0");
+    scpiSerial1Enqueue("s0");
+    scpiSerial1Enqueue("e0");
     gmDisarmEndOfPeriod();
 }
 
 // ── CONFigure subsystem ───────────────────────────────────────────────────────
 
-static void handleCONFVOLT(const String &param, bool isQuery)
+static void handleCONFVOLT(const char *param, bool isQuery)
 {
     if (isQuery)
     {
         Serial.println(gmState.voltage);
         return;
     }
-    int val = param.toInt();
+    int val = atoi(param);
     if (val < GM_VOLTAGE_MIN || val > GM_VOLTAGE_MAX)
     {
-        errParam("voltage must be " + String(GM_VOLTAGE_MIN) + ".." + String(GM_VOLTAGE_MAX) + " V");
+        errParam("voltage must be %d..%d V", GM_VOLTAGE_MIN, GM_VOLTAGE_MAX);
         return;
     }
     gmState.voltage = val;
-    Serial1.println("j" + String(val));
+    serial1Cmd('j', val);
 }
 
-static void handleCONFTIME(const String &param, bool isQuery)
+static void handleCONFTIME(const char *param, bool isQuery)
 {
     if (isQuery)
     {
         Serial.println(gmState.counting_time_mode);
         return;
     }
-    int val = param.toInt();
+    int val = atoi(param);
     if (val < GM_TIME_MODE_MIN || val > GM_TIME_MODE_MAX)
     {
-        errParam("time mode must be " + String(GM_TIME_MODE_MIN) + ".." + String(GM_TIME_MODE_MAX));
+        errParam("time mode must be %d..%d", GM_TIME_MODE_MIN, GM_TIME_MODE_MAX);
         return;
     }
     gmState.counting_time_mode = val;
-    Serial1.println("f" + String(val));
+    serial1Cmd('f', val);
 }
 
-static void handleCONFREP(const String &param, bool isQuery)
+static void handleCONFREP(const char *param, bool isQuery)
 {
     if (isQuery)
     {
         Serial.println(gmState.repeat ? "1" : "0");
         return;
     }
-    if (param == "ON" || param == "1")
+    if (streq(param, "ON") || streq(param, "1"))
         gmState.repeat = true;
-    else if (param == "OFF" || param == "0")
+    else if (streq(param, "OFF") || streq(param, "0"))
         gmState.repeat = false;
     else
     {
         errParam("repeat must be ON|OFF|1|0");
         return;
     }
-    Serial1.println(gmState.repeat ? "o1" : "o0");
+    serial1Cmd('o', gmState.repeat ? 1 : 0);
 }
 
-static void handleCONFSTR(const String &param, bool isQuery)
+static void handleCONFSTATS(const char *param, bool isQuery)
 {
     if (isQuery)
     {
-        Serial.println(gmState.stream_mode);
+        Serial.println(gmState.stats_sideband ? "1" : "0");
         return;
     }
-    int val = param.toInt();
-    if (val < 0 || val > 4)
+    if (streq(param, "ON") || streq(param, "1"))
     {
-        errParam("stream mode must be 0..4");
-        return;
+        // The 0xAB frame only survives in framed encodings; its bytes have
+        // the MSB set, so under ENC_VARINT they read as continuation bytes
+        // and garble up to a resync window of deltas every second.
+        if (gmState.encoding == ENC_VARINT)
+        {
+            errorQueue.push("-221,\"Settings conflict; stats sideband needs a framed encoding\"");
+            return;
+        }
+        gmState.stats_sideband = true;
     }
-    gmState.stream_mode = val;
-    Serial1.println("b" + String(val));
+    else if (streq(param, "OFF") || streq(param, "0"))
+        gmState.stats_sideband = false;
+    else
+        errParam("stats sideband must be ON|OFF|1|0");
+    // Arduino-local setting — nothing to forward to the GM counter hardware.
 }
 
-// ── FETCh subsystem ───────────────────────────────────────────────────────────
-
-// Busy-wait read from Serial1 — blocks for up to timeoutMs.
-// Only safe to call when gmState.streaming == false.
-static String readSerial1Line(unsigned long timeoutMs)
+static void handleCONFCH2(const char *param, bool isQuery)
 {
-    unsigned long t0 = millis();
-    String line;
-    while (millis() - t0 < timeoutMs)
+    if (isQuery)
+    {
+        Serial.println(gmState.ch2_enabled ? "1" : "0");
+        return;
+    }
+    if (gmState.streaming)
+    {
+        errorQueue.push("-213,\"Channel change ignored; acquisition running\"");
+        return;
+    }
+    if (streq(param, "ON") || streq(param, "1"))
     {
-        if (Serial1.available())
+        // The 0xA9 channel tag only exists in fixed-frame event streaming;
+        // histogram/burst/MCS/varint/seq paths carry no channel field.
+        if (gmState.acq_mode != ACQ_STREAM || gmState.encoding != ENC_FIXED)
         {
-            char c = (char)Serial1.read();
-            if (c == '\n')
-                break;
-            if (c != '\r')
-                line += c;
+            errorQueue.push("-221,\"Settings conflict; CH2 needs STREAM mode and FIXED encoding\"");
+            return;
         }
+        gmState.ch2_enabled = true;
     }
-    return line;
-}
-
-// Returns the GM counter status CSV: count,last_count,counting_time,repeat,progress,voltage,
-static void handleFETCStat()
-{
-    Serial1.println("b2");
-    String resp = readSerial1Line(300);
-    // b2 sets the hardware stream mode to 2; restore the configured value.
-    Serial1.println("b" + String(gmState.stream_mode));
-    if (resp.length() > 0)
-        Serial.println(resp);
+    else if (streq(param, "OFF") || streq(param, "0"))
+        gmState.ch2_enabled = false;
     else
-        errorQueue.push("-230,\"Data corrupt or stale; no response from GM counter\"");
+        errParam("ch2 must be ON|OFF|1|0");
+    // Arduino-local setting — nothing to forward to the GM counter hardware.
 }
 
-// ── HELP subsystem ───────────────────────────────────────────────────────────
-
-static void handleHELP()
+static void handleCONFWMARK(const char *param, bool isQuery)
 {
-    Serial.println(F("Available SCPI commands (* = query-only, ! = command-only):"));
-    Serial.println(F("  *IDN?                         Device identification"));
-    Serial.println(F("  *RST   !                      Reset device to defaults"));
-    Serial.println(F("  *CLS   !                      Clear error queue"));
-    Serial.println(F("  *TST?                         Self-test (returns 0)"));
-    Serial.println(F("  *OPC?                         Operation complete query"));
-    Serial.println(F("  SYST:ERR?                     Pop next error from queue"));
-    Serial.println(F("  SYST:CLR   !                  Clear GM counter event register"));
-    Serial.println(F("  SYST:DEB [ON|OFF|1|0]         Debug mode (query/set)"));
-    Serial.println(F("  SYST:VERS?                    SCPI version string"));
-    Serial.println(F("  INIT   !                      Start acquisition"));
-    Serial.println(F("  ABOR   !                      Stop acquisition"));
-    Serial.println(F("  CONF:VOLT [300..900]          HV voltage in V (query/set)"));
-    Serial.println(F("  CONF:TIME [0..9]              Counting time mode (query/set)"));
-    Serial.println(F("  CONF:REP  [ON|OFF|1|0]        Repeat mode (query/set)"));
-    Serial.println(F("  CONF:STR  [0..4]              Stream mode (query/set; 4=continuous)"));
-    Serial.println(F("  FETC:STAT?                    GM counter status CSV"));
-    Serial.println(F("  CONF:SPKR [0..3]  !           Speaker mode (0=off,1=click,2=tone,3=both)"));
-    Serial.println(F("  DIAG:STAT?                    Last-acquisition statistics CSV"));
-    Serial.println(F("  DIAG:PASS  !                  Toggle Serial1 passthrough (toggle again to exit)"));
-    Serial.println(F("  HELP?                         This help text"));
+    if (isQuery)
+    {
+        Serial.println((unsigned long)gmWatermark());
+        return;
+    }
+    if (gmState.streaming)
+    {
+        errorQueue.push("-213,\"Watermark change ignored; acquisition running\"");
+        return;
+    }
+    long val = atol(param);
+    if (val < 0 || val >= (long)RING_BUF_SIZE)
+    {
+        errParam("watermark must be 0..%d events (0 = off)", RING_BUF_SIZE - 1);
+        return;
+    }
+    gmConfigureWatermark((uint16_t)val);
+    // Arduino-local setting — nothing to forward to the GM counter hardware.
 }
 
-// ── DIAGnostic subsystem ──────────────────────────────────────────────────────
-
-static void handleCONFSPKR(const String &param, bool isQuery)
+static void handleCONFDEAD(const char *param, bool isQuery)
 {
     if (isQuery)
     {
-        errNotQueryable("CONF:SPKR"); // speaker mode is write-only
+        Serial.println((unsigned long)gmDeadtimeUs());
         return;
     }
-    int val = param.toInt();
-    if (val < GM_SPEAKER_MIN || val > GM_SPEAKER_MAX)
+    long val = atol(param);
+    if (val < 1 || (unsigned long)val > DEADTIME_MAX_US)
     {
-        // Modes: 0=both off, 1=GM click on, 2=ready tone on, 3=both on
-        errParam("speaker mode must be 0..3");
+        errParam("dead time must be 1..%lu us", (unsigned long)DEADTIME_MAX_US);
         return;
     }
-    Serial1.println("U" + String(val));
+    gmConfigureDeadtime((uint32_t)val);
+    // Arduino-local setting — nothing to forward to the GM counter hardware.
 }
 
-// Toggle Serial1 passthrough mode. When active, raw lines from Serial are forwarded
-// to Serial1 and Serial1 responses are relayed back. Only DIAG:PASS and ABOR are
-// intercepted; all other SCPI commands are bypassed.
-static void handleDIAGPASS(bool isQuery)
+static void handleCONFSYNC(const char *param, bool isQuery)
 {
     if (isQuery)
     {
-        Serial.println(gmState.passthrough ? "1" : "0");
+        Serial.println(gmState.sync_epoch ? "1" : "0");
         return;
     }
-    gmState.passthrough = !gmState.passthrough;
-    Serial.println(gmState.passthrough ? "PASS:ON" : "PASS:OFF");
+    if (streq(param, "ON") || streq(param, "1"))
+        gmState.sync_epoch = true;
+    else if (streq(param, "OFF") || streq(param, "0"))
+        gmState.sync_epoch = false;
+    else
+        errParam("sync epoch must be ON|OFF|1|0");
+    // Arduino-local setting — nothing to forward to the GM counter hardware.
 }
 
-// Returns last-acquisition statistics: dur_ms,npoints,debounced,overflows,tx_drops
-static void handleDIAGSTAT()
+static void handleCONFTRAIL(const char *param, bool isQuery)
 {
-    Serial.println(
-        String(acqStats.endMs - acqStats.startMs) + "," + String(acqStats.nPoints) + "," + String(acqStats.debounced) + "," + String(acqStats.overflows) + "," + String(acqStats.txDrops));
+    if (isQuery)
+    {
+        Serial.println(gmState.session_trailer ? "1" : "0");
+        return;
+    }
+    if (streq(param, "ON") || streq(param, "1"))
+        gmState.session_trailer = true;
+    else if (streq(param, "OFF") || streq(param, "0"))
+        gmState.session_trailer = false;
+    else
+        errParam("session trailer must be ON|OFF|1|0");
+    // Arduino-local setting — nothing to forward to the GM counter hardware.
 }
 
-// ── Dispatcher ────────────────────────────────────────────────────────────────
-//
-// Accepts both short forms (CONF:VOLT) and long forms (CONFIGURE:VOLTAGE).
-// Unrecognised headers push -113 onto the error queue.
-
-void scpiDispatch(const String &line)
+static void handleCONFSTR(const char *param, bool isQuery)
 {
-    String header, param;
-    bool isQuery;
-    if (!scpiParse(line, header, param, isQuery))
-        return;
-
-    // ── IEEE 488.2 ──
-    if (header == "*IDN")
+    if (isQuery)
     {
-        if (isQuery)
-            handleIDN();
-        else
-            errNotQueryable("*IDN");
+        Serial.println(gmState.stream_mode);
         return;
     }
-    if (header == "*RST")
+    int val = atoi(param);
+    if (val < 0 || val > 4)
     {
-        if (!isQuery)
-            handleRST();
-        else
-            errNotACommand("*RST");
+        errParam("stream mode must be 0..4");
         return;
     }
-    if (header == "*CLS")
+    gmState.stream_mode = val;
+    serial1Cmd('b', val);
+}
+
+static void handleCONFENC(const char *param, bool isQuery)
+{
+    if (isQuery)
     {
-        if (!isQuery)
-            handleCLS();
-        else
-            errNotACommand("*CLS");
+        Serial.println(gmState.encoding);
         return;
     }
-    if (header == "*TST")
+    // Changing the wire encoding mid-stream would desynchronise the host parser.
+    if (gmState.streaming)
     {
-        if (isQuery)
-            handleTST();
-        else
-            errNotQueryable("*TST");
+        errorQueue.push("-213,\"Encoding change ignored; acquisition running\"");
         return;
     }
-    if (header == "*OPC")
+    // CONF:CH2's STREAM+FIXED invariant must hold in both directions: the CH2
+    // drain emits fixed 0xA9 frames unconditionally, so leaving FIXED while
+    // the channel is enabled would corrupt the new stream.
+    if (gmState.ch2_enabled && !(streq(param, "FIXED") || streq(param, "0")))
     {
-        if (isQuery)
-            handleOPCQ();
-        else
-            errNotQueryable("*OPC");
+        errorQueue.push("-221,\"Settings conflict; disable CH2 before changing encoding\"");
         return;
     }
-
-    // ── SYSTem ──
-    if (header == "SYST:ERR" || header == "SYSTEM:ERROR")
+    if (streq(param, "FIXED") || streq(param, "0"))
+        gmState.encoding = ENC_FIXED;
+    else if (streq(param, "VARINT") || streq(param, "1"))
     {
-        if (isQuery)
-            handleSYSTERR();
-        else
-            errNotACommand("SYST:ERR");
-        return;
+        // Mirror of the CONF:STATS guard — the sideband cannot ride a varint
+        // stream, so the conflict must be caught from this direction too.
+        if (gmState.stats_sideband)
+        {
+            errorQueue.push("-221,\"Settings conflict; disable stats sideband before VARINT\"");
+            return;
+        }
+        gmState.encoding = ENC_VARINT;
     }
+    else if (streq(param, "SEQ") || streq(param, "2"))
+        gmState.encoding = ENC_SEQ;
+    else
+        errParam("encoding must be FIXED|VARINT|SEQ|0|1|2");
+    // Arduino-local setting — nothing to forward to the GM counter hardware.
+}
 
-    if (header == "SYST:CLR" || header == "SYST:CLEAR" || header == "SYSTEM:CLEAR")
+static void handleCONFACQ(const char *param, bool isQuery)
+{
+    if (isQuery)
     {
-        if (!isQuery)
-            handleSYSTCLR();
-        else
-            errNotQueryable("SYST:CLR");
+        Serial.println(gmState.acq_mode);
         return;
     }
-
-    if (header == "SYST:DEB" || header == "SYST:DEBUG" || header == "SYSTEM:DEBUG")
+    if (gmState.streaming)
     {
-        handleSYSTDEB(param, isQuery);
+        errorQueue.push("-213,\"Acquisition mode change ignored; acquisition running\"");
         return;
     }
-
-    // SCPI 1999 mandatory
-    if (header == "SYST:VERS" || header == "SYSTEM:VERSION")
+    // Reverse of the CONF:CH2 guard — the channel only exists in STREAM mode.
+    if (gmState.ch2_enabled && !(streq(param, "STREAM") || streq(param, "0")))
     {
-        if (isQuery)
-            Serial.println("1999.0");
-        else
-            errNotACommand("SYST:VERS");
+        errorQueue.push("-221,\"Settings conflict; disable CH2 before changing acquisition mode\"");
         return;
     }
+    if (streq(param, "STREAM") || streq(param, "0"))
+        gmState.acq_mode = ACQ_STREAM;
+    else if (streq(param, "HIST") || streq(param, "1"))
+        gmState.acq_mode = ACQ_HIST;
+    else if (streq(param, "BURST") || streq(param, "2"))
+        gmState.acq_mode = ACQ_BURST; // keeps the previously configured target
+    else if (strncmp(param, "BURST,", 6) == 0)
+    {
+        long n = atol(param + 6);
+        if (n <= 0 || n > (long)BURST_BUF_SIZE)
+        {
+            errParam("burst size must be 1..%d", BURST_BUF_SIZE);
+            return;
+        }
+        gmConfigureBurst((uint32_t)n);
+        gmState.acq_mode = ACQ_BURST;
+    }
+    else if (streq(param, "MCS") || streq(param, "3"))
+        gmState.acq_mode = ACQ_MCS; // keeps the previously configured width
+    else if (strncmp(param, "MCS,", 4) == 0)
+    {
+        long w = atol(param + 4);
+        if (w <= 0 || w > (long)MCS_WIDTH_MAX_US)
+        {
+            errParam("mcs width must be 1..%lu us", MCS_WIDTH_MAX_US);
+            return;
+        }
+        gmConfigureMcs((uint32_t)w);
+        gmState.acq_mode = ACQ_MCS;
+    }
+    else if (streq(param, "RNG") || streq(param, "4"))
+        gmState.acq_mode = ACQ_RNG; // keeps the previously configured debiaser
+    else if (streq(param, "RNG,VN"))
+    {
+        gmConfigureRng(RNG_VN);
+        gmState.acq_mode = ACQ_RNG;
+    }
+    else if (streq(param, "RNG,PAR"))
+    {
+        gmConfigureRng(RNG_PARITY);
+        gmState.acq_mode = ACQ_RNG;
+    }
+    else
+        errParam("acquisition mode must be STREAM|HIST|BURST[,n]|MCS[,us]|RNG[,VN|PAR]|0..4");
+}
 
-    // ── INITiate / ABORt ──
-    if (header == "INIT" || header == "INIT:IMM" || header == "INITIATE:IMMEDIATE")
+// CONF:HIST LOG          — 32 log2-spaced bins (default)
+// CONF:HIST LIN,<width>  — HIST_LIN_BINS linear bins of <width> µs each
+static void handleCONFHIST(const char *param, bool isQuery)
+{
+    if (isQuery)
     {
-        if (!isQuery)
-            handleINIT();
+        if (gmHistogramIsLinear())
+        {
+            char resp[24];
+            snprintf(resp, sizeof(resp), "LIN,%lu",
+                     (unsigned long)(gmHistogramWidthTicks() / TICKS_PER_US));
+            Serial.println(resp);
+        }
         else
-            errNotACommand("INIT");
+        {
+            Serial.println("LOG");
+        }
         return;
     }
-
-    if (header == "ABOR" || header == "ABORT")
+    if (streq(param, "LOG"))
     {
-        if (!isQuery)
-            handleABOR();
-        else
-            errNotACommand("ABOR");
+        gmConfigureHistogram(false, 0);
         return;
     }
-
-    // ── CONFigure ──
-    if (header == "CONF:VOLT" || header == "CONFIGURE:VOLTAGE")
+    if (strncmp(param, "LIN,", 4) == 0)
     {
-        handleCONFVOLT(param, isQuery);
+        long width_us = atol(param + 4);
+        if (width_us <= 0)
+        {
+            errParam("linear bin width must be a positive integer (us)");
+            return;
+        }
+        gmConfigureHistogram(true, (uint32_t)width_us * TICKS_PER_US);
         return;
     }
+    errParam("histogram config must be LOG or LIN,<width_us>");
+}
 
-    if (header == "CONF:TIME" || header == "CONFIGURE:TIME")
-    {
-        handleCONFTIME(param, isQuery);
+// ── FETCh subsystem ───────────────────────────────────────────────────────────
+// FETC:STAT? is asynchronous: the handler issues b2 and returns immediately;
+// scpiService() — pumped from loop() — assembles the 9600-baud reply
+// incrementally and prints it once the newline arrives.  The old
+// implementation busy-waited up to 300 ms inside the handler, freezing all
+// SCPI input for up to ~30 % of idle time under the host's 1 Hz status poll.
+
+static const unsigned long FETCH_TIMEOUT_MS = 300;
+
+static bool _fetchPending = false;
+static char _fetchBuf[64];
+static size_t _fetchLen = 0;
+static unsigned long _fetchStartMs = 0;
+
+bool scpiFetchPending() { return _fetchPending; }
+
+// Finish the pending fetch: restore the configured hardware stream mode
+// (b2 changed it) and emit either the reply line or a -230 error.
+static void fetchFinish(bool gotReply)
+{
+    _fetchPending = false;
+    serial1Cmd('b', gmState.stream_mode);
+    if (gotReply)
+        Serial.println(_fetchBuf);
+    else
+        errorQueue.push("-230,\"Data corrupt or stale; no response from GM counter\"");
+}
+
+void scpiService()
+{
+    if (!_fetchPending)
         return;
+    while (Serial1.available() > 0)
+    {
+        char c = (char)Serial1.read();
+        if (c == '\n')
+        {
+            _fetchBuf[_fetchLen] = '\0';
+            fetchFinish(_fetchLen > 0);
+            return;
+        }
+        if (c != '\r' && _fetchLen < sizeof(_fetchBuf) - 1)
+            _fetchBuf[_fetchLen++] = c;
     }
+    if (millis() - _fetchStartMs >= FETCH_TIMEOUT_MS)
+        fetchFinish(false);
+}
 
-    if (header == "CONF:REP" || header == "CONFIGURE:REPEAT")
+// Requests the GM counter status CSV: count,last_count,counting_time,repeat,progress,voltage,
+// The reply is emitted later by scpiService() — see above.
+static void handleFETCStat(const char *, bool)
+{
+    if (_fetchPending)
     {
-        handleCONFREP(param, isQuery);
+        errorQueue.push("-213,\"FETC:STAT? ignored; previous fetch still pending\"");
         return;
     }
+    serial1Cmd('b', 2); // 'b' is uncached — the trigger always goes out
+    _fetchPending = true;
+    _fetchLen = 0;
+    _fetchStartMs = millis();
+}
+
+// ── HELP subsystem ───────────────────────────────────────────────────────────
 
-    if (header == "CONF:STR" || header == "CONFIGURE:STREAM")
+static void handleHELP(const char *, bool)
+{
+    Serial.println(F("Available SCPI commands (* = query-only, ! = command-only):"));
+    Serial.println(F("  *IDN?                         Device identification"));
+    Serial.println(F("  *RST   !                      Reset device to defaults"));
+    Serial.println(F("  *CLS   !                      Clear error queue"));
+    Serial.println(F("  *TST?                         Self-test (returns 0)"));
+    Serial.println(F("  *OPC?                         Operation complete query"));
+    Serial.println(F("  SYST:ERR?                     Pop next error from queue"));
+    Serial.println(F("  SYST:CLR   !                  Clear GM counter event register"));
+    Serial.println(F("  SYST:DEB [ON|OFF|1|0]         Debug mode (query/set)"));
+    Serial.println(F("  SYST:SYNC?                    Clock pair ticks,millis (drift fitting)"));
+    Serial.println(F("  SYST:VERS?                    SCPI version string"));
+    Serial.println(F("  SYST:BAUD [9600..115200]      GM counter link rate (query/set)"));
+    Serial.println(F("  INIT   !                      Start acquisition"));
+    Serial.println(F("  INIT:FAST !                   Start reusing applied configuration"));
+    Serial.println(F("  ABOR   !                      Stop acquisition"));
+    Serial.println(F("  CONF:VOLT [300..900]          HV voltage in V (query/set)"));
+    Serial.println(F("  CONF:TIME [0..9]              Counting time mode (query/set)"));
+    Serial.println(F("  CONF:REP  [ON|OFF|1|0]        Repeat mode (query/set)"));
+    Serial.println(F("  CONF:STR  [0..4]              Stream mode (query/set; 4=continuous)"));
+    Serial.println(F("  CONF:ENC  [FIXED|VARINT|SEQ|0|1|2]  Binary stream encoding (query/set)"));
+    Serial.println(F("  CONF:ACQ  [STREAM|HIST|BURST[,n]|MCS[,us]|RNG[,VN|PAR]|0..4]  Acquisition mode (query/set)"));
+    Serial.println(F("  CONF:HIST [LOG|LIN,<us>]      Histogram binning (query/set)"));
+    Serial.println(F("  CONF:STATS [ON|OFF|1|0]       Live 0xAB stats sideband (query/set)"));
+    Serial.println(F("  CONF:SYNC [ON|OFF|1|0]        0xAD epoch packet at stream start (query/set)"));
+    Serial.println(F("  CONF:TRAIL [ON|OFF|1|0]       0xB1 session trailer after end marker (query/set)"));
+    Serial.println(F("  CONF:CH2  [ON|OFF|1|0]        Second capture channel, 0xA9 frames (query/set)"));
+    Serial.println(F("  CONF:DEAD [us]                Tube dead time for the delta classifier (query/set)"));
+    Serial.println(F("  CONF:WMARK [0..1023]          Ring backlog watermark, 0xB0 degrade frames (query/set)"));
+    Serial.println(F("  FETC:STAT?                    GM counter status CSV"));
+    Serial.println(F("  CONF:SPKR [0..3]  !           Speaker mode (0=off,1=click,2=tone,3=both)"));
+    Serial.println(F("  DIAG:STAT?                    Last-acquisition statistics CSV (counts + delta moments)"));
+    Serial.println(F("  DIAG:PROF?                    Drain-loop latency profile (log2 gap histogram)"));
+    Serial.println(F("  DIAG:SELFTEST?                Max loss-free rate sweep (streams synthetic data)"));
+    Serial.println(F("  DIAG:PASS  !                  Toggle Serial1 passthrough (toggle again to exit)"));
+    Serial.println(F("  HELP?                         This help text"));
+    Serial.println(F("  binary: 0x81=INIT 0x82=ABOR 0x83,<n>=CONF:VOLT 300+2n"));
+}
+
+// ── DIAGnostic subsystem ──────────────────────────────────────────────────────
+
+static void handleCONFSPKR(const char *param, bool)
+{
+    int val = atoi(param);
+    if (val < GM_SPEAKER_MIN || val > GM_SPEAKER_MAX)
     {
-        handleCONFSTR(param, isQuery);
+        // Modes: 0=both off, 1=GM click on, 2=ready tone on, 3=both on
+        errParam("speaker mode must be 0..3");
         return;
     }
+    serial1Cmd('U', val);
+}
 
-    // ── FETCh ──
-    if (header == "FETC:STAT" || header == "FETCH:STATUS")
+// Toggle Serial1 passthrough mode. When active, raw lines from Serial are forwarded
+// to Serial1 and Serial1 responses are relayed back. Only DIAG:PASS and ABOR are
+// intercepted; all other SCPI commands are bypassed.
+static void handleDIAGPASS(const char *, bool isQuery)
+{
+    if (isQuery)
     {
-        if (isQuery)
-            handleFETCStat();
-        else
-            errNotQueryable("FETC:STAT");
+        Serial.println(gmState.passthrough ? "1" : "0");
         return;
     }
+    gmState.passthrough = !gmState.passthrough;
+    // Raw host lines bypass the cache while passthrough is on, so whatever it
+    // believed about the hardware is void either way the toggle goes.
+    scpiHwCacheInvalidate();
+    Serial.println(gmState.passthrough ? "PASS:ON" : "PASS:OFF");
+}
 
-    // ── DIAGnostic ──
-    if (header == "CONF:SPKR" || header == "CONFIGURE:SPEAKER")
+// Max-rate characterization: sweep the internal pulse generator and report the
+// highest loss-free rate as "SELFTEST,<rate_hz>".  Each trial emits a normal
+// binary stream (start marker + packets) that the host must discard before
+// reading the text reply.  Blocking — a full sweep takes a few seconds.
+static void handleDIAGSELFTEST(const char *, bool)
+{
+    if (gmState.streaming)
     {
-        handleCONFSPKR(param, isQuery);
+        errorQueue.push("-213,\"Self-test ignored; acquisition running\"");
         return;
     }
+    // The sweep qualifies the per-event streaming path.  In HIST/MCS/RNG (or
+    // a compressed encoding) a trial generates little or no per-event TX
+    // traffic, so txDrops cannot occur and the reported ceiling would badly
+    // overstate what streaming sustains — pin STREAM + FIXED for the sweep
+    // and restore the configured mode afterwards.
+    int savedMode = gmState.acq_mode;
+    int savedEnc = gmState.encoding;
+    gmState.acq_mode = ACQ_STREAM;
+    gmState.encoding = ENC_FIXED;
+    uint32_t best = gmSelfTest();
+    gmState.acq_mode = savedMode;
+    gmState.encoding = savedEnc;
+    char resp[32];
+    snprintf(resp, sizeof(resp), "SELFTEST,%lu", (unsigned long)best);
+    Serial.println(resp);
+}
+
+// Drain-loop latency profile:
+//   max_gap_us,ring_peak,txlen_peak,b0,...,b15
+// where b_i counts drain-pass gaps in [2^i, 2^(i+1)) µs.  Read after a run
+// that reported overflows to see whether — and how badly — the drain stalled.
+static void handleDIAGPROF(const char *, bool)
+{
+    const GmProfile &p = gmProfile();
+    char resp[224];
+    int n = snprintf(resp, sizeof(resp), "%lu,%u,%u",
+                     (unsigned long)p.maxGapUs, (unsigned)p.ringPeak,
+                     (unsigned)p.txLenPeak);
+    for (uint8_t i = 0; i < PROF_BINS; i++)
+        n += snprintf(resp + n, sizeof(resp) - (size_t)n, ",%lu",
+                      (unsigned long)p.bins[i]);
+    Serial.println(resp);
+}
+
+// Returns last-acquisition statistics:
+//   dur_ms,npoints,debounced,overflows,tx_drops,min,max,mean,variance,
+//   sub_dead,near_dead
+// min..variance are over accepted deltas in firmware timer ticks — the host
+// divides by ticks_per_us (ticks_per_us² for the variance).  With on-device
+// moments a sweep point needs only this one line, not the raw delta stream.
+// sub_dead / near_dead are the CONF:DEAD classifier counters (deltas below τ
+// and within [τ, 2τ)) — the inputs of a dead-time fit.
+static void handleDIAGSTAT(const char *, bool)
+{
+    char resp[160];
+    snprintf(resp, sizeof(resp), "%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.1f,%.1f,%lu,%lu",
+             acqStats.endMs - acqStats.startMs, acqStats.nPoints,
+             acqStats.debounced, acqStats.overflows, acqStats.txDrops,
+             acqStats.minDelta, acqStats.maxDelta, acqStats.meanDelta,
+             acqStats.variance(), acqStats.subDead, acqStats.nearDead);
+    Serial.println(resp);
+}
 
-    if (header == "DIAG:STAT" || header == "DIAGNOSTIC:STATUS")
+// ── Binary fast path ──────────────────────────────────────────────────────────
+//
+// Scripted sweeps issue thousands of CONF:VOLT / INIT / ABOR cycles, and the
+// text path (newline accumulation → scpiParse → bsearch) is a measurable slice
+// of per-point time.  These opcodes reach the same handlers with zero parsing.
+// OP_VOLT spans two bytes; the pending flag survives across loop() iterations
+// in case the operand arrives in a later USB chunk.
+
+static bool _fastVoltPending = false;
+
+bool scpiFastByte(uint8_t b)
+{
+    if (_fastVoltPending)
+    {
+        _fastVoltPending = false;
+        if (gmState.streaming)
+        {
+            errorQueue.push("-213,\"Init ignored; streaming is active\"");
+            return true;
+        }
+        char v[8];
+        snprintf(v, sizeof(v), "%d", GM_VOLTAGE_MIN + 2 * (int)b);
+        handleCONFVOLT(v, false);
+        return true;
+    }
+    switch (b)
     {
-        if (isQuery)
-            handleDIAGSTAT();
+    case OP_INIT:
+        if (gmState.streaming)
+            errorQueue.push("-213,\"Init ignored; streaming is active\"");
         else
-            errNotQueryable("DIAG:STAT");
-        return;
+            handleINIT("", false);
+        return true;
+    case OP_ABOR:
+        handleABOR("", false);
+        return true;
+    case OP_VOLT:
+        _fastVoltPending = true;
+        return true;
+    default:
+        return false;
     }
+}
+
+// ── Dispatcher ────────────────────────────────────────────────────────────────
+//
+// Static table sorted by header, searched with bsearch() — O(log n) and
+// independent of where a command sits in this file, so the headers we poll
+// hardest in sweeps (FETC:STAT?, DIAG:STAT?) cost the same as any other.
+// Short and long forms (CONF:VOLT / CONFIGURE:VOLTAGE) are separate entries.
+// Unrecognised headers push -113 onto the error queue.
 
-    if (header == "DIAG:PASS" || header == "DIAGNOSTIC:PASSTHROUGH")
+enum CmdForm : uint8_t
+{
+    CMD_BOTH,         // query and command forms both valid
+    CMD_QUERY_ONLY,   // command form pushes errNotACommand
+    CMD_COMMAND_ONLY, // query form pushes errNotQueryable
+};
+
+struct ScpiCommand
+{
+    const char *header;    // lookup key — table MUST stay strcmp-sorted
+    const char *canonical; // short form used in error messages
+    CmdForm form;
+    void (*handler)(const char *param, bool isQuery);
+};
+
+static const ScpiCommand _commands[] = {
+    {"*CLS", "*CLS", CMD_COMMAND_ONLY, handleCLS},
+    {"*IDN", "*IDN", CMD_QUERY_ONLY, handleIDN},
+    {"*OPC", "*OPC", CMD_QUERY_ONLY, handleOPCQ},
+    {"*RST", "*RST", CMD_COMMAND_ONLY, handleRST},
+    {"*TST", "*TST", CMD_QUERY_ONLY, handleTST},
+    {"ABOR", "ABOR", CMD_COMMAND_ONLY, handleABOR},
+    {"ABORT", "ABOR", CMD_COMMAND_ONLY, handleABOR},
+    {"CONF:ACQ", "CONF:ACQ", CMD_BOTH, handleCONFACQ},
+    {"CONF:CH2", "CONF:CH2", CMD_BOTH, handleCONFCH2},
+    {"CONF:DEAD", "CONF:DEAD", CMD_BOTH, handleCONFDEAD},
+    {"CONF:ENC", "CONF:ENC", CMD_BOTH, handleCONFENC},
+    {"CONF:HIST", "CONF:HIST", CMD_BOTH, handleCONFHIST},
+    {"CONF:REP", "CONF:REP", CMD_BOTH, handleCONFREP},
+    {"CONF:SPKR", "CONF:SPKR", CMD_COMMAND_ONLY, handleCONFSPKR},
+    {"CONF:STATS", "CONF:STATS", CMD_BOTH, handleCONFSTATS},
+    {"CONF:STR", "CONF:STR", CMD_BOTH, handleCONFSTR},
+    {"CONF:SYNC", "CONF:SYNC", CMD_BOTH, handleCONFSYNC},
+    {"CONF:TIME", "CONF:TIME", CMD_BOTH, handleCONFTIME},
+    {"CONF:TRAIL", "CONF:TRAIL", CMD_BOTH, handleCONFTRAIL},
+    {"CONF:VOLT", "CONF:VOLT", CMD_BOTH, handleCONFVOLT},
+    {"CONF:WMARK", "CONF:WMARK", CMD_BOTH, handleCONFWMARK},
+    {"CONFIGURE:ACQUISITION", "CONF:ACQ", CMD_BOTH, handleCONFACQ},
+    {"CONFIGURE:CHANNEL2", "CONF:CH2", CMD_BOTH, handleCONFCH2},
+    {"CONFIGURE:DEADTIME", "CONF:DEAD", CMD_BOTH, handleCONFDEAD},
+    {"CONFIGURE:ENCODING", "CONF:ENC", CMD_BOTH, handleCONFENC},
+    {"CONFIGURE:HISTOGRAM", "CONF:HIST", CMD_BOTH, handleCONFHIST},
+    {"CONFIGURE:REPEAT", "CONF:REP", CMD_BOTH, handleCONFREP},
+    {"CONFIGURE:SPEAKER", "CONF:SPKR", CMD_COMMAND_ONLY, handleCONFSPKR},
+    {"CONFIGURE:STATISTICS", "CONF:STATS", CMD_BOTH, handleCONFSTATS},
+    {"CONFIGURE:STREAM", "CONF:STR", CMD_BOTH, handleCONFSTR},
+    {"CONFIGURE:SYNCHRONIZATION", "CONF:SYNC", CMD_BOTH, handleCONFSYNC},
+    {"CONFIGURE:TIME", "CONF:TIME", CMD_BOTH, handleCONFTIME},
+    {"CONFIGURE:TRAILER", "CONF:TRAIL", CMD_BOTH, handleCONFTRAIL},
+    {"CONFIGURE:VOLTAGE", "CONF:VOLT", CMD_BOTH, handleCONFVOLT},
+    {"CONFIGURE:WATERMARK", "CONF:WMARK", CMD_BOTH, handleCONFWMARK},
+    {"DIAG:PASS", "DIAG:PASS", CMD_BOTH, handleDIAGPASS},
+    {"DIAG:PROF", "DIAG:PROF", CMD_QUERY_ONLY, handleDIAGPROF},
+    {"DIAG:SELFTEST", "DIAG:SELFTEST", CMD_QUERY_ONLY, handleDIAGSELFTEST},
+    {"DIAG:STAT", "DIAG:STAT", CMD_QUERY_ONLY, handleDIAGSTAT},
+    {"DIAGNOSTIC:PASSTHROUGH", "DIAG:PASS", CMD_BOTH, handleDIAGPASS},
+    {"DIAGNOSTIC:PROFILE", "DIAG:PROF", CMD_QUERY_ONLY, handleDIAGPROF},
+    {"DIAGNOSTIC:SELFTEST", "DIAG:SELFTEST", CMD_QUERY_ONLY, handleDIAGSELFTEST},
+    {"DIAGNOSTIC:STATUS", "DIAG:STAT", CMD_QUERY_ONLY, handleDIAGSTAT},
+    {"FETC:STAT", "FETC:STAT", CMD_QUERY_ONLY, handleFETCStat},
+    {"FETCH:STATUS", "FETC:STAT", CMD_QUERY_ONLY, handleFETCStat},
+    {"HELP", "HELP", CMD_QUERY_ONLY, handleHELP},
+    {"INIT", "INIT", CMD_COMMAND_ONLY, handleINIT},
+    {"INIT:FAST", "INIT:FAST", CMD_COMMAND_ONLY, handleINITFAST},
+    {"INIT:IMM", "INIT", CMD_COMMAND_ONLY, handleINIT},
+    {"INITIATE:FAST", "INIT:FAST", CMD_COMMAND_ONLY, handleINITFAST},
+    {"INITIATE:IMMEDIATE", "INIT", CMD_COMMAND_ONLY, handleINIT},
+    {"SYST:BAUD", "SYST:BAUD", CMD_BOTH, handleSYSTBAUD},
+    {"SYST:CLEAR", "SYST:CLR", CMD_COMMAND_ONLY, handleSYSTCLR},
+    {"SYST:CLR", "SYST:CLR", CMD_COMMAND_ONLY, handleSYSTCLR},
+    {"SYST:DEB", "SYST:DEB", CMD_BOTH, handleSYSTDEB},
+    {"SYST:DEBUG", "SYST:DEB", CMD_BOTH, handleSYSTDEB},
+    {"SYST:ERR", "SYST:ERR", CMD_QUERY_ONLY, handleSYSTERR},
+    {"SYST:SYNC", "SYST:SYNC", CMD_QUERY_ONLY, handleSYSTSYNC},
+    {"SYST:VERS", "SYST:VERS", CMD_QUERY_ONLY, handleSYSTVERS},
+    {"SYSTEM:BAUD", "SYST:BAUD", CMD_BOTH, handleSYSTBAUD},
+    {"SYSTEM:CLEAR", "SYST:CLR", CMD_COMMAND_ONLY, handleSYSTCLR},
+    {"SYSTEM:DEBUG", "SYST:DEB", CMD_BOTH, handleSYSTDEB},
+    {"SYSTEM:ERROR", "SYST:ERR", CMD_QUERY_ONLY, handleSYSTERR},
+    {"SYSTEM:SYNCHRONIZATION", "SYST:SYNC", CMD_QUERY_ONLY, handleSYSTSYNC},
+    {"SYSTEM:VERSION", "SYST:VERS", CMD_QUERY_ONLY, handleSYSTVERS},
+};
+
+static const size_t _numCommands = sizeof(_commands) / sizeof(_commands[0]);
+
+static int cmdCompare(const void *key, const void *elem)
+{
+    return strcmp((const char *)key, ((const ScpiCommand *)elem)->header);
+}
+
+void scpiDispatch(const char *line)
+{
+    char header[SCPI_MAX_HEADER], param[SCPI_MAX_PARAM];
+    bool isQuery;
+    if (!scpiParse(line, header, param, isQuery))
+        return;
+
+    const ScpiCommand *cmd = (const ScpiCommand *)bsearch(
+        header, _commands, _numCommands, sizeof(ScpiCommand), cmdCompare);
+    if (cmd == nullptr)
     {
-        handleDIAGPASS(isQuery);
+        errUndefined(header);
         return;
     }
-
-    // ── HELP ──
-    if (header == "HELP")
+    if (cmd->form == CMD_QUERY_ONLY && !isQuery)
     {
-        if (isQuery)
-            handleHELP();
-        else
-            errNotACommand("HELP");
+        errNotACommand(cmd->canonical);
         return;
     }
-
-    errUndefined(header);
+    if (cmd->form == CMD_COMMAND_ONLY && isQuery)
+    {
+        errNotQueryable(cmd->canonical);
+        return;
+    }
+    cmd->handler(param, isQuery);
 }
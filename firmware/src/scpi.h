@@ -2,10 +2,48 @@
 #include <Arduino.h>
 #include "state.h"
 
-// Parse one SCPI command line.
-// Strips the trailing '?' into isQuery; uppercases header and param.
-// Returns false if line is empty.
-bool scpiParse(const String &line, String &header, String &param, bool &isQuery);
+// Fixed buffer sizes for the allocation-free parser.  The longest defined
+// header is well under 32 chars (e.g. "CONFIGURE:ACQUISITION" = 21) and the
+// input line itself is capped at CMD_MAX_LEN in main.cpp.
+#define SCPI_MAX_HEADER 32
+#define SCPI_MAX_PARAM 32
+
+// Parse one SCPI command line into caller-provided fixed buffers
+// (capacities SCPI_MAX_HEADER / SCPI_MAX_PARAM; over-long parts are truncated).
+// Strips the trailing '?' into isQuery; uppercases header and param in place.
+// Returns false if line is empty.  Performs no heap allocation.
+bool scpiParse(const char *line, char *header, char *param, bool &isQuery);
 
 // Route a complete command line to the correct handler.
-void scpiDispatch(const String &line);
+void scpiDispatch(const char *line);
+
+// Binary fast path: returns true if *b* was consumed as a single-byte opcode
+// (OP_INIT / OP_ABOR / OP_VOLT + operand, config.h) — the caller must then
+// skip text accumulation for it.  Opcodes hit the same handlers as the text
+// forms; INIT and VOLT are rejected with -213 while streaming, like text.
+bool scpiFastByte(uint8_t b);
+
+// Pump asynchronous SCPI work — currently the incremental FETC:STAT? reply
+// assembly.  Call from loop() on every idle iteration; returns immediately
+// when nothing is pending.
+void scpiService();
+
+// True while a FETC:STAT? reply is still being assembled from Serial1.
+// loop() must not treat Serial1 bytes as unsolicited stream data meanwhile.
+bool scpiFetchPending();
+
+// Queue one line for the GM counter link.  Lines are sent FIFO by
+// scpiSerial1Service() and only when the UART can take the whole line without
+// blocking; an over-full queue forces the oldest line out synchronously
+// rather than dropping it.
+void scpiSerial1Enqueue(const char *line);
+
+// Drain queued Serial1 lines as UART space allows; returns without blocking.
+// Call from loop() on every pass (both streaming and idle).
+void scpiSerial1Service();
+
+// Drop the cached Serial1 hardware state (last-written voltage, time mode,
+// repeat, stream mode) so every cached letter is re-sent on its next write.
+// Called internally by *RST and DIAG:PASS; exposed for tests and for any
+// future path that bypasses serial1Cmd().
+void scpiHwCacheInvalidate();
@@ -1,31 +1,41 @@
 #pragma once
 #include <Arduino.h>
+#include <stdio.h>
 #include "config.h"
 
 // ── Error queue (SYST:ERR?) ───────────────────────────────────────────────────
+// Fixed-storage circular buffer.  push() is called from the streaming hot path
+// (the -213 rejection in loop()), so both operations are O(1) byte copies into
+// preallocated slots — error reporting never touches the heap.
 struct ErrorQueue
 {
-    String msgs[ERR_QUEUE_SIZE];
+    char msgs[ERR_QUEUE_SIZE][ERR_MSG_LEN];
+    uint8_t head = 0; // index of the oldest entry
     uint8_t count = 0;
 
-    void push(const String &msg)
+    void push(const char *msg)
     {
-        if (count < ERR_QUEUE_SIZE)
-            msgs[count++] = msg;
+        if (count >= ERR_QUEUE_SIZE)
+            return; // queue full — extras are dropped, per SCPI convention
+        uint8_t slot = (uint8_t)((head + count) % ERR_QUEUE_SIZE);
+        snprintf(msgs[slot], ERR_MSG_LEN, "%s", msg);
+        count++;
     }
 
-    String pop()
+    // Returns the oldest entry, or the SCPI "no error" sentinel.  The pointer
+    // aliases the queue's own storage and is only guaranteed until the next
+    // push into that slot — callers print it immediately.
+    const char *pop()
     {
         if (count == 0)
-            return F("0,\"No error\"");
-        String e = msgs[0];
-        for (uint8_t i = 1; i < count; ++i)
-            msgs[i - 1] = msgs[i];
+            return "0,\"No error\"";
+        const char *e = msgs[head];
+        head = (uint8_t)((head + 1) % ERR_QUEUE_SIZE);
         --count;
         return e;
     }
 
-    void clear() { count = 0; }
+    void clear() { head = count = 0; }
 };
 
 // ── Acquisition statistics ────────────────────────────────────────────────────
@@ -38,7 +48,47 @@ struct AcqStats
     unsigned long overflows = 0; // ISR ring-buffer overflow events (pulses dropped)
     unsigned long txDrops = 0;   // TX batch flushes where Serial.write() dropped bytes
 
-    void reset() { startMs = endMs = nPoints = debounced = overflows = txDrops = 0; }
+    // Dead-time classification (CONF:DEAD) — accepted deltas below the
+    // configured tube dead time τ, and within [τ, 2τ).  Counted by the drain
+    // path (gm_core owns the thresholds); they split nPoints, not add to it.
+    unsigned long subDead = 0;
+    unsigned long nearDead = 0;
+
+    // Streaming moments over accepted deltas (firmware timer ticks), folded in
+    // per event by addDelta().  Welford's recurrence keeps the variance
+    // numerically stable without a sum-of-squares accumulator, which would
+    // overflow 64 bits for deltas anywhere near the 32-bit wire limit.
+    unsigned long minDelta = 0; // 0 until the first accepted point
+    unsigned long maxDelta = 0;
+    double meanDelta = 0.0;
+    double m2 = 0.0; // sum of squared deviations from the running mean
+
+    void reset()
+    {
+        startMs = endMs = nPoints = debounced = overflows = txDrops = 0;
+        subDead = nearDead = 0;
+        minDelta = maxDelta = 0;
+        meanDelta = m2 = 0.0;
+    }
+
+    // Fold one accepted delta into the counters and running moments.
+    void addDelta(uint32_t delta)
+    {
+        nPoints++;
+        if (nPoints == 1 || delta < minDelta)
+            minDelta = delta;
+        if (delta > maxDelta)
+            maxDelta = delta;
+        double d = (double)delta - meanDelta;
+        meanDelta += d / (double)nPoints;
+        m2 += d * ((double)delta - meanDelta);
+    }
+
+    // Sample variance in ticks²; 0 with fewer than two points.
+    double variance() const
+    {
+        return nPoints > 1 ? m2 / (double)(nPoints - 1) : 0.0;
+    }
 
     // Emit five STAT: lines — only call when the host is in idle (text) mode,
     // never while the binary acquisition stream is open.
@@ -60,6 +110,25 @@ struct GmState
     bool repeat = DEFAULT_REPEAT;
     int counting_time_mode = DEFAULT_TIME_MODE;
     int stream_mode = DEFAULT_STREAM_MODE;
+    // Binary stream encoding: ENC_FIXED (6-byte frames) or ENC_VARINT (LEB128).
+    // Arduino-local — no Serial1 command; the host negotiates it via CONF:ENC.
+    int encoding = DEFAULT_ENCODING;
+    // Acquisition mode: ACQ_STREAM (per-event deltas), ACQ_HIST (on-device
+    // histogram, one bin-array frame per second), ACQ_BURST (capture to
+    // SRAM, stream afterwards), ACQ_MCS (counts per fixed-width time bin),
+    // or ACQ_RNG (packed entropy bytes).  Arduino-local (CONF:ACQ).
+    int acq_mode = DEFAULT_ACQ_MODE;
+    // Live 0xAB stats sideband during streaming.  Arduino-local (CONF:STATS).
+    bool stats_sideband = DEFAULT_STATS_SIDEBAND;
+    // 0xAD clock-sync epoch packet after the start marker.  Arduino-local
+    // (CONF:SYNC).
+    bool sync_epoch = DEFAULT_SYNC_EPOCH;
+    // Second capture channel on D3, 0xA9-tagged frames.  Arduino-local
+    // (CONF:CH2); requires ACQ_STREAM + ENC_FIXED.
+    bool ch2_enabled = DEFAULT_CH2;
+    // 0xB1 session trailer after the 0xEE end sentinel.  Arduino-local
+    // (CONF:TRAIL).
+    bool session_trailer = DEFAULT_TRAILER;
     bool debug = false;
     bool passthrough = false;
     // True when e1 end-of-period detection is active (finite time, not repeat).
@@ -165,6 +165,7 @@ struct MockSerial
     size_t inputPos = 0;
 
     void begin(unsigned long) {}
+    void flush() {}
 
     void println(const String &s) { lines.push_back(s.c_str()); }
     void println(const char *s) { lines.push_back(s); }
@@ -183,8 +184,10 @@ struct MockSerial
         return n;
     }
 
-    // Always report plenty of TX space so txFlush() never stalls in tests.
-    int availableForWrite() const { return 4096; }
+    // Defaults to plenty of TX space so txFlush() never stalls in tests;
+    // lower txSpace to exercise back-pressure paths.
+    int txSpace = 4096;
+    int availableForWrite() const { return txSpace; }
 
     int available() const { return (int)(inputBuf.size() - inputPos); }
     int read()
@@ -212,6 +215,7 @@ struct MockSerial
         bytes.clear();
         inputBuf.clear();
         inputPos = 0;
+        txSpace = 4096;
     }
 };
 
@@ -0,0 +1,127 @@
+// Throughput benchmarks — speed, not correctness.  Each "test" drives a hot
+// path with synthetic load against the arduino_mock, prints its rate, and
+// makes only sanity assertions so a functionally broken build still fails
+// loudly.  Excluded from the default native test run; execute with:
+//
+//   pio test -e native_bench -v
+//
+// Numbers are host-relative: compare runs on the same machine (before/after a
+// hot-path change), not against the RA4M1's absolute throughput.
+#include <unity.h>
+
+#include <chrono>
+
+#include "arduino_mock.h"
+#include "../../src/state.cpp"
+#include "../../src/gm_core.cpp"
+#include "../../src/scpi.cpp"
+
+static void reset_all()
+{
+    Serial.clear();
+    Serial1.clear();
+    errorQueue.clear();
+    acqStats.reset();
+    gmState = GmState{};
+    gmResetAcquisition();
+    set_mock_millis(0);
+    set_mock_micros(0);
+}
+
+void setUp() { reset_all(); }
+void tearDown() {}
+
+static double secondsSince(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+        .count();
+}
+
+// Pulse EVENTS times in ring-friendly batches through gmISR() and drain each
+// batch with gmProcessAcquisition(), exactly like loop() does at full rate.
+static void benchStream(const char *label)
+{
+    const unsigned long EVENTS = 1000000UL;
+    const unsigned long BATCH = 64; // well under RING_BUF_SIZE
+
+    gmStartAcquisition();
+    Serial.clear();
+
+    unsigned long us = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned long done = 0; done < EVENTS; done += BATCH)
+    {
+        for (unsigned long i = 0; i < BATCH; i++)
+        {
+            us += 1000; // comfortably above DEBOUNCE_TICKS
+            set_mock_micros(us);
+            gmISR();
+        }
+        gmProcessAcquisition();
+        Serial.bytes.clear(); // keep the mock's capture vector flat
+    }
+    double dt = secondsSince(t0);
+
+    printf("bench: %-24s %10.0f events/s  (%lu events, %.3f s)\n", label,
+           (double)EVENTS / dt, EVENTS, dt);
+
+    TEST_ASSERT_EQUAL(EVENTS - 1, acqStats.nPoints); // first pulse = baseline
+    TEST_ASSERT_EQUAL(0, (int)acqStats.overflows);
+    TEST_ASSERT_EQUAL(0, (int)acqStats.txDrops);
+}
+
+void bench_stream_fixed_encoding()
+{
+    benchStream("stream, fixed frames");
+}
+
+void bench_stream_varint_encoding()
+{
+    gmState.encoding = ENC_VARINT;
+    benchStream("stream, varint frames");
+}
+
+void bench_stream_seq_encoding()
+{
+    gmState.encoding = ENC_SEQ;
+    benchStream("stream, seq+crc frames");
+}
+
+// Command storm through the full parse → bsearch → handler pipeline, mixing a
+// Serial1 round trip (CONF:VOLT), a snprintf-heavy query (DIAG:STAT?) and the
+// error-queue pop (SYST:ERR?) — the commands sweeps poll hardest.
+void bench_scpi_dispatch_storm()
+{
+    const unsigned long ITERS = 100000UL;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < ITERS; i++)
+    {
+        scpiDispatch("CONF:VOLT 500");
+        scpiDispatch("DIAG:STAT?");
+        scpiDispatch("SYST:ERR?");
+        if ((i & 0xFF) == 0)
+        {
+            Serial.clear(); // keep the mocks' capture vectors flat
+            Serial1.clear();
+        }
+    }
+    double dt = secondsSince(t0);
+
+    const unsigned long dispatches = 3 * ITERS;
+    printf("bench: %-24s %10.0f ns/dispatch  (%lu dispatches, %.3f s)\n",
+           "scpi dispatch storm", dt * 1e9 / (double)dispatches, dispatches,
+           dt);
+
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(bench_stream_fixed_encoding);
+    RUN_TEST(bench_stream_varint_encoding);
+    RUN_TEST(bench_stream_seq_encoding);
+    RUN_TEST(bench_scpi_dispatch_storm);
+    return UNITY_END();
+}
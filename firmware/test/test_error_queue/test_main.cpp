@@ -9,17 +9,15 @@ void tearDown() {}
 
 void test_empty_queue_returns_no_error()
 {
-    String resp = errorQueue.pop();
     // Must start with "0," per SCPI spec
-    TEST_ASSERT_TRUE(resp.startsWith("0,"));
+    TEST_ASSERT_TRUE(strncmp("0,", errorQueue.pop(), 2) == 0);
 }
 
 void test_push_pop_single_item()
 {
     errorQueue.push("-102,\"Parameter out of range\"");
     TEST_ASSERT_EQUAL(1, errorQueue.count);
-    String e = errorQueue.pop();
-    TEST_ASSERT_EQUAL_STRING("-102,\"Parameter out of range\"", e.c_str());
+    TEST_ASSERT_EQUAL_STRING("-102,\"Parameter out of range\"", errorQueue.pop());
     TEST_ASSERT_EQUAL(0, errorQueue.count);
 }
 
@@ -27,8 +25,7 @@ void test_pop_after_empty_returns_no_error()
 {
     errorQueue.push("-102,\"err\"");
     errorQueue.pop();
-    String e = errorQueue.pop();
-    TEST_ASSERT_TRUE(e.startsWith("0,"));
+    TEST_ASSERT_TRUE(strncmp("0,", errorQueue.pop(), 2) == 0);
 }
 
 void test_fifo_ordering()
@@ -36,9 +33,9 @@ void test_fifo_ordering()
     errorQueue.push("first");
     errorQueue.push("second");
     errorQueue.push("third");
-    TEST_ASSERT_EQUAL_STRING("first", errorQueue.pop().c_str());
-    TEST_ASSERT_EQUAL_STRING("second", errorQueue.pop().c_str());
-    TEST_ASSERT_EQUAL_STRING("third", errorQueue.pop().c_str());
+    TEST_ASSERT_EQUAL_STRING("first", errorQueue.pop());
+    TEST_ASSERT_EQUAL_STRING("second", errorQueue.pop());
+    TEST_ASSERT_EQUAL_STRING("third", errorQueue.pop());
 }
 
 void test_overflow_ignored()
@@ -55,7 +52,41 @@ void test_clear_empties_queue()
     errorQueue.push("b");
     errorQueue.clear();
     TEST_ASSERT_EQUAL(0, errorQueue.count);
-    TEST_ASSERT_TRUE(errorQueue.pop().startsWith("0,"));
+    TEST_ASSERT_TRUE(strncmp("0,", errorQueue.pop(), 2) == 0);
+}
+
+void test_circular_reuse_after_wraparound()
+{
+    // Drive head all the way around the ring: fill, drain, fill again.
+    char msg[16];
+    for (int i = 0; i < ERR_QUEUE_SIZE; i++)
+    {
+        snprintf(msg, sizeof(msg), "gen1-%d", i);
+        errorQueue.push(msg);
+    }
+    for (int i = 0; i < ERR_QUEUE_SIZE; i++)
+        errorQueue.pop();
+    for (int i = 0; i < ERR_QUEUE_SIZE; i++)
+    {
+        snprintf(msg, sizeof(msg), "gen2-%d", i);
+        errorQueue.push(msg);
+    }
+    for (int i = 0; i < ERR_QUEUE_SIZE; i++)
+    {
+        snprintf(msg, sizeof(msg), "gen2-%d", i);
+        TEST_ASSERT_EQUAL_STRING(msg, errorQueue.pop());
+    }
+}
+
+void test_overlong_message_truncated_not_overrun()
+{
+    char big[2 * ERR_MSG_LEN];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    errorQueue.push(big);
+    const char *e = errorQueue.pop();
+    TEST_ASSERT_EQUAL(ERR_MSG_LEN - 1, (int)strlen(e));
+    TEST_ASSERT_EQUAL('x', e[0]);
 }
 
 int main()
@@ -67,5 +98,7 @@ int main()
     RUN_TEST(test_fifo_ordering);
     RUN_TEST(test_overflow_ignored);
     RUN_TEST(test_clear_empties_queue);
+    RUN_TEST(test_circular_reuse_after_wraparound);
+    RUN_TEST(test_overlong_message_truncated_not_overrun);
     return UNITY_END();
 }
@@ -33,6 +33,27 @@ void test_start_sends_six_ff_marker()
         TEST_ASSERT_EQUAL_HEX8(0xFF, Serial.bytes[i]);
 }
 
+void test_epoch_packet_follows_start_marker_when_enabled()
+{
+    gmState.sync_epoch = true;
+    set_mock_micros(1234);
+    set_mock_millis(77);
+    gmStartAcquisition();
+
+    // 6×0xFF start marker, then [0xAD, ticks LE32, millis LE32, 0, 0, 0x55].
+    TEST_ASSERT_EQUAL(6 + EPOCH_FRAME_LEN, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(EPOCH_MARKER_BYTE, Serial.bytes[6]);
+    uint32_t ticks = (uint32_t)Serial.bytes[7] | ((uint32_t)Serial.bytes[8] << 8) |
+                     ((uint32_t)Serial.bytes[9] << 16) |
+                     ((uint32_t)Serial.bytes[10] << 24);
+    uint32_t ms = (uint32_t)Serial.bytes[11] | ((uint32_t)Serial.bytes[12] << 8) |
+                  ((uint32_t)Serial.bytes[13] << 16) |
+                  ((uint32_t)Serial.bytes[14] << 24);
+    TEST_ASSERT_EQUAL(1234, ticks);
+    TEST_ASSERT_EQUAL(77, ms);
+    TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes[17]);
+}
+
 void test_stop_clears_streaming_flag()
 {
     gmStartAcquisition();
@@ -44,9 +65,58 @@ void test_reset_clears_stats()
 {
     acqStats.nPoints = 100;
     acqStats.debounced = 5;
+    acqStats.subDead = 2;
+    acqStats.nearDead = 7;
+    acqStats.minDelta = 480;
+    acqStats.maxDelta = 960;
+    acqStats.meanDelta = 720.0;
+    acqStats.m2 = 12.5;
     gmResetAcquisition();
     TEST_ASSERT_EQUAL(0, acqStats.nPoints);
     TEST_ASSERT_EQUAL(0, acqStats.debounced);
+    TEST_ASSERT_EQUAL(0, acqStats.subDead);
+    TEST_ASSERT_EQUAL(0, acqStats.nearDead);
+    TEST_ASSERT_EQUAL(0, acqStats.minDelta);
+    TEST_ASSERT_EQUAL(0, acqStats.maxDelta);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 0.0, acqStats.meanDelta);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 0.0, acqStats.m2);
+}
+
+// ── Streaming statistics (Welford moments) ────────────────────────────────────
+
+void test_moments_match_known_dataset()
+{
+    // Textbook dataset: mean 5, sample variance 32/7.
+    const uint32_t data[] = {2, 4, 4, 4, 5, 5, 7, 9};
+    acqStats.reset();
+    for (size_t i = 0; i < sizeof(data) / sizeof(data[0]); i++)
+        acqStats.addDelta(data[i]);
+
+    TEST_ASSERT_EQUAL(8, acqStats.nPoints);
+    TEST_ASSERT_EQUAL(2, acqStats.minDelta);
+    TEST_ASSERT_EQUAL(9, acqStats.maxDelta);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 5.0, acqStats.meanDelta);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 32.0 / 7.0, acqStats.variance());
+}
+
+void test_moments_updated_by_drain_loop()
+{
+    gmStartAcquisition();
+    Serial.clear();
+
+    // Pulses at 0, 1000, 3000 → accepted deltas 1000 and 2000 ticks.
+    set_mock_micros(0);
+    gmISR();
+    set_mock_micros(1000);
+    gmISR();
+    set_mock_micros(3000);
+    gmISR();
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(2, acqStats.nPoints);
+    TEST_ASSERT_EQUAL(1000, acqStats.minDelta);
+    TEST_ASSERT_EQUAL(2000, acqStats.maxDelta);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 1500.0, acqStats.meanDelta);
 }
 
 // ── First pulse — no packet ───────────────────────────────────────────────────
@@ -77,6 +147,8 @@ void test_two_pulses_produce_one_packet()
     set_mock_micros(2000);
     gmISR();
     gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1); // deadline passes...
+    gmProcessAcquisition();                    // ...and the held batch flushes
 
     TEST_ASSERT_EQUAL(1, acqStats.nPoints);
     TEST_ASSERT_EQUAL(6, (int)Serial.bytes.size());
@@ -95,6 +167,8 @@ void test_packet_framing_bytes()
     set_mock_micros(1000);
     gmISR(); // delta = 1000 µs
     gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
 
     TEST_ASSERT_EQUAL_HEX8(0xAA, Serial.bytes[0]);
     TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes[5]);
@@ -111,6 +185,8 @@ void test_packet_delta_little_endian()
     set_mock_micros(1234);
     gmISR();
     gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
 
     TEST_ASSERT_EQUAL_HEX8(0xD2, Serial.bytes[1]); // LSB
     TEST_ASSERT_EQUAL_HEX8(0x04, Serial.bytes[2]);
@@ -146,6 +222,8 @@ void test_delta_just_above_debounce_passes()
     set_mock_micros(DEBOUNCE_US + 1);
     gmISR(); // one above threshold
     gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
 
     TEST_ASSERT_EQUAL(6, (int)Serial.bytes.size());
     TEST_ASSERT_EQUAL(1, acqStats.nPoints);
@@ -174,6 +252,8 @@ void test_multiple_valid_pulses()
     set_mock_micros(t);
     gmISR();
 
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
     gmProcessAcquisition();
 
     // 4 ISR calls → 3 deltas → 3 packets of 6 bytes each
@@ -198,6 +278,8 @@ void test_burst_across_batches_emits_all_packets()
         gmISR();
     }
     gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1); // flush the below-batch remainder
+    gmProcessAcquisition();
 
     TEST_ASSERT_EQUAL(pulses - 1, (int)acqStats.nPoints);
     TEST_ASSERT_EQUAL((pulses - 1) * 6, (int)Serial.bytes.size());
@@ -206,6 +288,47 @@ void test_burst_across_batches_emits_all_packets()
     TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes.back());
 }
 
+// ── Rate-adaptive flush deadline ──────────────────────────────────────────────
+// A below-batch packet is held up to TX_FLUSH_DEADLINE_MS for coalescing; a
+// full batch still flushes immediately regardless of the clock.
+
+void test_partial_batch_held_until_deadline()
+{
+    gmStartAcquisition();
+    Serial.clear();
+
+    set_mock_micros(0);
+    gmISR();
+    set_mock_micros(500);
+    gmISR();
+    gmProcessAcquisition();
+    TEST_ASSERT_EQUAL(0, (int)Serial.bytes.size()); // held — deadline not hit
+
+    set_mock_millis(TX_FLUSH_DEADLINE_MS - 1);
+    gmProcessAcquisition();
+    TEST_ASSERT_EQUAL(0, (int)Serial.bytes.size()); // still inside the window
+
+    set_mock_millis(TX_FLUSH_DEADLINE_MS);
+    gmProcessAcquisition();
+    TEST_ASSERT_EQUAL(6, (int)Serial.bytes.size()); // deadline reached — flushed
+}
+
+void test_full_batch_flushes_without_deadline()
+{
+    gmStartAcquisition();
+    Serial.clear();
+
+    // TX_BATCH_PACKETS + 1 pulses → a full batch, flushed with millis stuck at 0.
+    for (int i = 0; i <= TX_BATCH_PACKETS; i++)
+    {
+        set_mock_micros((uint32_t)i * 500UL);
+        gmISR();
+    }
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(TX_BATCH_PACKETS * 6, (int)Serial.bytes.size());
+}
+
 // ── Ring buffer wrap-around ───────────────────────────────────────────────────
 
 void test_ring_buffer_overflow_no_crash()
@@ -288,91 +411,1180 @@ void test_reset_clears_overflow_count()
     TEST_ASSERT_EQUAL(0, (int)acqStats.overflows);
 }
 
-// ── End-of-period detection ───────────────────────────────────────────────────
+// ── Varint encoding (ENC_VARINT) ─────────────────────────────────────────────
 
-void test_arm_eop_sets_state()
+void test_varint_single_byte_delta()
 {
-    gmStartAcquisition(); // sets acqStats.startMs = millis() = 0
-    gmArmEndOfPeriod(10000); // 10 s period
-    TEST_ASSERT_TRUE(gmState.endPeriodArmed);
+    gmState.encoding = ENC_VARINT;
+    gmStartAcquisition();
+    Serial.clear();
+
+    set_mock_micros(0);
+    gmISR();
+    set_mock_micros(100); // delta = 100 = 0x64 → one LEB128 byte
+    gmISR();
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(1, acqStats.nPoints);
+    TEST_ASSERT_EQUAL(1, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(0x64, Serial.bytes[0]);
 }
 
-void test_disarm_eop_clears_state()
+void test_varint_two_byte_delta()
 {
+    gmState.encoding = ENC_VARINT;
     gmStartAcquisition();
-    gmArmEndOfPeriod(10000);
-    gmDisarmEndOfPeriod();
-    TEST_ASSERT_FALSE(gmState.endPeriodArmed);
+    Serial.clear();
+
+    set_mock_micros(0);
+    gmISR();
+    set_mock_micros(1000); // delta = 1000 = 0x3E8 → [0xE8, 0x07]
+    gmISR();
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(2, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(0xE8, Serial.bytes[0]); // low 7 bits + continuation
+    TEST_ASSERT_EQUAL_HEX8(0x07, Serial.bytes[1]); // high bits, final
 }
 
-void test_eop_not_reached_early()
+void test_varint_resync_marker_emitted_after_interval()
 {
-    // Armed, but millis is 0 and no Serial1 data → not reached yet.
+    gmState.encoding = ENC_VARINT;
     gmStartAcquisition();
-    gmArmEndOfPeriod(10000);
-    set_mock_millis(100); // 0.1 s — far before period
-    TEST_ASSERT_FALSE(gmEndOfPeriodReached());
+    Serial.clear();
+
+    // VARINT_RESYNC_INTERVAL + 1 deltas of 100 µs (one varint byte each):
+    // 64 data bytes, then the 5 × 0xFF marker, then the 65th delta byte.
+    for (int i = 0; i <= VARINT_RESYNC_INTERVAL + 1; i++)
+    {
+        set_mock_micros((uint32_t)i * 100UL);
+        gmISR();
+    }
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(VARINT_RESYNC_INTERVAL + 1, (int)acqStats.nPoints);
+    TEST_ASSERT_EQUAL(VARINT_RESYNC_INTERVAL + VARINT_RESYNC_LEN + 1,
+                      (int)Serial.bytes.size());
+    for (int i = 0; i < VARINT_RESYNC_LEN; i++)
+        TEST_ASSERT_EQUAL_HEX8(VARINT_RESYNC_BYTE,
+                               Serial.bytes[VARINT_RESYNC_INTERVAL + i]);
+    TEST_ASSERT_EQUAL_HEX8(0x64, Serial.bytes.back());
 }
 
-void test_eop_reached_timer_fallback()
+// ── Sequenced frames (ENC_SEQ) ────────────────────────────────────────────────
+// Frame layout: [0xAA, seq(u8), delta LE32, crc8, 0x55] — 8 bytes.
+
+// Reference CRC-8 (poly 0x07, init 0x00) for verifying emitted frames.
+static uint8_t ref_crc8(const uint8_t *data, size_t len)
 {
-    // millis exceeds period + margin → timer fallback fires.
-    gmStartAcquisition(); // startMs = 0
-    gmArmEndOfPeriod(1000); // 1 s period
-    set_mock_millis(1000 + GM_END_PERIOD_MARGIN_MS + 1);
-    TEST_ASSERT_TRUE(gmEndOfPeriodReached());
+    uint8_t crc = 0;
+    while (len--)
+    {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
 }
 
-void test_eop_reached_serial1_after_half_period()
+void test_seq_frame_layout_and_crc()
 {
-    // Serial1 has data AND elapsed > period/2 → device-authoritative trigger.
-    gmStartAcquisition(); // startMs = 0
-    gmArmEndOfPeriod(1000);
-    set_mock_millis(600); // > 500 ms (half of 1 s)
-    Serial1.setInput("42\n"); // e1 result line
-    TEST_ASSERT_TRUE(gmEndOfPeriodReached());
+    gmState.encoding = ENC_SEQ;
+    gmStartAcquisition();
+    Serial.clear();
+
+    // delta = 0x000004D2 = 1234 µs
+    set_mock_micros(0);
+    gmISR();
+    set_mock_micros(1234);
+    gmISR();
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(SEQ_FRAME_LEN, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(0xAA, Serial.bytes[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, Serial.bytes[1]); // first seq after start
+    TEST_ASSERT_EQUAL_HEX8(0xD2, Serial.bytes[2]); // delta LSB
+    TEST_ASSERT_EQUAL_HEX8(0x04, Serial.bytes[3]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, Serial.bytes[4]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, Serial.bytes[5]); // delta MSB
+    uint8_t body[5] = {Serial.bytes[1], Serial.bytes[2], Serial.bytes[3],
+                       Serial.bytes[4], Serial.bytes[5]};
+    TEST_ASSERT_EQUAL_HEX8(ref_crc8(body, 5), Serial.bytes[6]);
+    TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes[7]);
 }
 
-void test_eop_not_triggered_serial1_before_half_period()
+void test_seq_counter_increments_per_packet()
 {
-    // Serial1 has data but elapsed < period/2 — this is the s1 echo guard.
-    gmStartAcquisition(); // startMs = 0
-    gmArmEndOfPeriod(1000);
-    set_mock_millis(200); // < 500 ms (half of 1 s)
-    Serial1.setInput("42\n");
-    TEST_ASSERT_FALSE(gmEndOfPeriodReached());
+    gmState.encoding = ENC_SEQ;
+    gmStartAcquisition();
+    Serial.clear();
+
+    for (int i = 0; i < 5; i++)
+    {
+        set_mock_micros((uint32_t)i * 500UL);
+        gmISR();
+    }
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+
+    // 5 pulses → 4 frames; seq bytes must read 0, 1, 2, 3.
+    TEST_ASSERT_EQUAL(4 * SEQ_FRAME_LEN, (int)Serial.bytes.size());
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL_HEX8(i, Serial.bytes[i * SEQ_FRAME_LEN + 1]);
 }
 
-void test_emit_end_marker_writes_six_ee()
+void test_seq_counter_resets_on_start()
 {
-    // gmEmitEndMarker must write 0xEE×6 to Serial after flushing any pending data.
+    gmState.encoding = ENC_SEQ;
     gmStartAcquisition();
-    Serial.clear(); // discard start marker
-    gmEmitEndMarker();
-    TEST_ASSERT_EQUAL(6, (int)Serial.bytes.size());
-    for (int i = 0; i < 6; i++)
-        TEST_ASSERT_EQUAL_HEX8(0xEE, Serial.bytes[i]);
+    set_mock_micros(0);
+    gmISR();
+    set_mock_micros(500);
+    gmISR();
+    gmProcessAcquisition();
+    gmStopAcquisition();
+
+    gmStartAcquisition(); // second stream — seq must start over at 0
+    Serial.clear();
+    set_mock_micros(1000);
+    gmISR();
+    set_mock_micros(1500);
+    gmISR();
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL_HEX8(0x00, Serial.bytes[1]);
 }
 
-int main()
+// ── On-device histogram (ACQ_HIST) ────────────────────────────────────────────
+// Frame layout: [0xAC, nbins(u8), nbins × count LE32, 0x55].
+
+void test_hist_mode_sends_no_per_event_packets()
 {
-    UNITY_BEGIN();
-    RUN_TEST(test_start_sets_streaming_flag);
-    RUN_TEST(test_start_sends_six_ff_marker);
-    RUN_TEST(test_stop_clears_streaming_flag);
-    RUN_TEST(test_reset_clears_stats);
-    RUN_TEST(test_first_isr_produces_no_packet);
-    RUN_TEST(test_two_pulses_produce_one_packet);
-    RUN_TEST(test_packet_framing_bytes);
-    RUN_TEST(test_packet_delta_little_endian);
-    RUN_TEST(test_delta_at_debounce_threshold_filtered);
-    RUN_TEST(test_delta_just_above_debounce_passes);
-    RUN_TEST(test_multiple_valid_pulses);
-    RUN_TEST(test_burst_across_batches_emits_all_packets);
-    RUN_TEST(test_ring_buffer_overflow_no_crash);
-    RUN_TEST(test_isr_overflow_counted);
-    RUN_TEST(test_isr_overflow_does_not_overwrite_buffer);
-    RUN_TEST(test_reset_clears_overflow_count);
+    gmState.acq_mode = ACQ_HIST;
+    gmConfigureHistogram(false, 0); // log2 bins
+    gmStartAcquisition();
+    Serial.clear();
+
+    for (int i = 0; i < 10; i++)
+    {
+        set_mock_micros((uint32_t)i * 500UL);
+        gmISR();
+    }
+    gmProcessAcquisition(); // millis still 0 — before the first emit interval
+
+    TEST_ASSERT_EQUAL(9, acqStats.nPoints);
+    TEST_ASSERT_EQUAL(0, (int)Serial.bytes.size());
+}
+
+void test_hist_frame_emitted_after_interval()
+{
+    gmState.acq_mode = ACQ_HIST;
+    gmConfigureHistogram(false, 0);
+    gmStartAcquisition();
+    Serial.clear();
+
+    // 9 deltas of 100 µs → log2 bin 6 (64 <= 100 < 128).
+    for (int i = 0; i < 10; i++)
+    {
+        set_mock_micros((uint32_t)i * 100UL);
+        gmISR();
+    }
+    set_mock_millis(HIST_EMIT_INTERVAL_MS + 1);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(2 + 4 * HIST_LOG_BINS + 1, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(HIST_MARKER_BYTE, Serial.bytes[0]);
+    TEST_ASSERT_EQUAL(HIST_LOG_BINS, Serial.bytes[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes.back());
+    // Bin 6 count = 9 (LE32 at offset 2 + 6*4).
+    TEST_ASSERT_EQUAL(9, Serial.bytes[2 + 6 * 4]);
+    TEST_ASSERT_EQUAL(0, Serial.bytes[2 + 6 * 4 + 1]);
+}
+
+void test_hist_linear_binning()
+{
+    gmState.acq_mode = ACQ_HIST;
+    gmConfigureHistogram(true, 100); // 100-tick (= 100 µs native) linear bins
+    gmStartAcquisition();
+    Serial.clear();
+
+    // Deltas: 150 µs → bin 1, 250 µs → bin 2.
+    set_mock_micros(0);
+    gmISR();
+    set_mock_micros(150);
+    gmISR();
+    set_mock_micros(400);
+    gmISR();
+    set_mock_millis(HIST_EMIT_INTERVAL_MS + 1);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(2 + 4 * HIST_LIN_BINS + 1, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL(HIST_LIN_BINS, Serial.bytes[1]);
+    TEST_ASSERT_EQUAL(0, Serial.bytes[2 + 0 * 4]); // bin 0 empty
+    TEST_ASSERT_EQUAL(1, Serial.bytes[2 + 1 * 4]); // 150 µs
+    TEST_ASSERT_EQUAL(1, Serial.bytes[2 + 2 * 4]); // 250 µs
+
+    gmConfigureHistogram(false, 0); // restore default for later tests
+}
+
+void test_hist_stop_emits_final_snapshot()
+{
+    gmState.acq_mode = ACQ_HIST;
+    gmConfigureHistogram(false, 0);
+    gmStartAcquisition();
+    Serial.clear();
+
+    set_mock_micros(0);
+    gmISR();
+    set_mock_micros(100);
+    gmISR();
+    gmProcessAcquisition(); // before emit interval — nothing sent yet
+    TEST_ASSERT_EQUAL(0, (int)Serial.bytes.size());
+
+    gmStopAcquisition(); // must flush one final histogram frame
+    TEST_ASSERT_EQUAL(2 + 4 * HIST_LOG_BINS + 1, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(HIST_MARKER_BYTE, Serial.bytes[0]);
+}
+
+// ── 64-bit wrap extension ─────────────────────────────────────────────────────
+// In native builds ticks == micros(), so the counter wraps at 2^32 µs.  The
+// drain loop must count wraps it observes between events and keep deltas exact.
+
+void test_event_latched_before_wrap_drained_after()
+{
+    gmStartAcquisition();
+    Serial.clear();
+
+    // Two events just before the wrap, drained only after micros() wrapped.
+    set_mock_micros(0xFFFFFF00UL);
+    gmISR();
+    set_mock_micros(0xFFFFFFF0UL);
+    gmISR();
+    set_mock_micros(0x10UL); // counter wrapped before the drain ran
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(1, acqStats.nPoints);
+    TEST_ASSERT_EQUAL_HEX8(0xF0, Serial.bytes[1]); // delta = 0xF0, LSB first
+    TEST_ASSERT_EQUAL_HEX8(0x00, Serial.bytes[2]);
+}
+
+void test_gap_across_one_wrap_measured_exactly()
+{
+    gmStartAcquisition();
+    Serial.clear();
+
+    set_mock_micros(1000);
+    gmISR();
+    gmProcessAcquisition(); // drain first event (no packet yet)
+
+    // Intermediate drain cycles observe the counter before and after the wrap.
+    set_mock_micros(0x80000000UL);
+    gmProcessAcquisition();
+    set_mock_micros(0x10UL); // wrapped
+    gmProcessAcquisition();
+
+    set_mock_micros(500);
+    gmISR();
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+
+    // delta = (2^32 - 1000) + 500 = 0xFFFFFE0C
+    TEST_ASSERT_EQUAL(1, acqStats.nPoints);
+    TEST_ASSERT_EQUAL_HEX8(0x0C, Serial.bytes[1]);
+    TEST_ASSERT_EQUAL_HEX8(0xFE, Serial.bytes[2]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, Serial.bytes[3]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, Serial.bytes[4]);
+}
+
+void test_gap_across_two_wraps_saturates()
+{
+    gmStartAcquisition();
+    Serial.clear();
+
+    set_mock_micros(1000);
+    gmISR();
+    gmProcessAcquisition();
+
+    // Walk the drain loop through two full wraps with no events in between.
+    set_mock_micros(0x80000000UL);
+    gmProcessAcquisition();
+    set_mock_micros(0x10UL);
+    gmProcessAcquisition(); // wrap 1
+    set_mock_micros(0x80000000UL);
+    gmProcessAcquisition();
+    set_mock_micros(0x10UL);
+    gmProcessAcquisition(); // wrap 2
+
+    set_mock_micros(2000);
+    gmISR();
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+
+    // True delta exceeds 2^32 ticks — wire value must saturate, not alias.
+    TEST_ASSERT_EQUAL(1, acqStats.nPoints);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, Serial.bytes[1]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, Serial.bytes[2]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, Serial.bytes[3]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, Serial.bytes[4]);
+}
+
+// ── Burst capture (ACQ_BURST) ─────────────────────────────────────────────────
+
+void test_burst_capture_no_tx_until_target()
+{
+    gmState.acq_mode = ACQ_BURST;
+    gmConfigureBurst(10);
+    gmStartAcquisition();
+    Serial.clear();
+
+    // 6 pulses → 5 deltas, below the target of 10: everything stays in SRAM.
+    for (int i = 0; i < 6; i++)
+    {
+        set_mock_micros((uint32_t)i * 500UL);
+        gmISR();
+    }
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(0, (int)Serial.bytes.size());
+    TEST_ASSERT_TRUE(gmState.streaming);
+    TEST_ASSERT_EQUAL(5, acqStats.nPoints);
+}
+
+void test_burst_playback_and_end_marker_at_target()
+{
+    gmState.acq_mode = ACQ_BURST;
+    gmConfigureBurst(4);
+    gmStartAcquisition();
+    gmArmEndOfPeriod(10000); // finite time — must be disarmed by the self-stop
+    Serial.clear();
+
+    for (int i = 0; i < 5; i++)
+    {
+        set_mock_micros((uint32_t)i * 500UL);
+        gmISR();
+    }
+    gmProcessAcquisition();
+
+    // 4 captured deltas play back as normal packets, then the 0xEE sentinel
+    // (no trailer — CONF:TRAIL is off by default).
+    TEST_ASSERT_EQUAL(4 * 6 + 6, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(0xAA, Serial.bytes[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xF4, Serial.bytes[1]); // delta = 500 = 0x01F4, LSB
+    TEST_ASSERT_EQUAL_HEX8(0x01, Serial.bytes[2]);
+    for (int i = 0; i < 6; i++)
+        TEST_ASSERT_EQUAL_HEX8(0xEE, Serial.bytes[4 * 6 + i]);
+    TEST_ASSERT_FALSE(gmState.streaming); // the run ends itself
+    // …and leaves no stale end-of-period state behind; the hardware stop is
+    // flagged exactly once for loop() to send s0/e0.
+    TEST_ASSERT_FALSE(gmState.endPeriodArmed);
+    TEST_ASSERT_TRUE(gmTakeHwStopPending());
+    TEST_ASSERT_FALSE(gmTakeHwStopPending()); // consumed
+}
+
+void test_burst_target_clamped_to_buffer()
+{
+    gmConfigureBurst(BURST_BUF_SIZE + 1);
+    TEST_ASSERT_EQUAL(BURST_BUF_SIZE, (int)gmBurstTarget());
+    gmConfigureBurst(0);
+    TEST_ASSERT_EQUAL(BURST_BUF_SIZE, (int)gmBurstTarget());
+}
+
+// ── MCS interval counting (ACQ_MCS) ───────────────────────────────────────────
+// Frame: [0xAE, bin_idx LE16, count LE32, 0x55] — one per closed bin.
+
+static uint32_t mcs_frame_count(int frame)
+{
+    const int b = frame * MCS_FRAME_LEN;
+    return (uint32_t)Serial.bytes[b + 3] | ((uint32_t)Serial.bytes[b + 4] << 8) |
+           ((uint32_t)Serial.bytes[b + 5] << 16) |
+           ((uint32_t)Serial.bytes[b + 6] << 24);
+}
+
+void test_mcs_counts_events_per_bin()
+{
+    gmState.acq_mode = ACQ_MCS;
+    gmConfigureMcs(1000);
+    gmStartAcquisition();
+    Serial.clear();
+
+    // Baseline pulse plus two accepted deltas, all inside bin 0.
+    set_mock_micros(100);
+    gmISR();
+    set_mock_micros(200);
+    gmISR();
+    set_mock_micros(300);
+    gmISR();
+    gmProcessAcquisition();
+    TEST_ASSERT_EQUAL(0, (int)Serial.bytes.size()); // bin still open
+
+    set_mock_micros(1500); // crosses the 1000 µs boundary
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(MCS_FRAME_LEN, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(MCS_MARKER_BYTE, Serial.bytes[0]);
+    TEST_ASSERT_EQUAL(0, Serial.bytes[1] | (Serial.bytes[2] << 8)); // bin_idx
+    TEST_ASSERT_EQUAL(2, mcs_frame_count(0));
+    TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes[7]);
+}
+
+void test_mcs_emits_empty_bins()
+{
+    gmState.acq_mode = ACQ_MCS;
+    gmConfigureMcs(1000);
+    gmStartAcquisition();
+    Serial.clear();
+
+    set_mock_micros(3500); // three full bins elapse with no pulses
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(3 * MCS_FRAME_LEN, (int)Serial.bytes.size());
+    const int b = 2 * MCS_FRAME_LEN;
+    TEST_ASSERT_EQUAL(2, Serial.bytes[b + 1] | (Serial.bytes[b + 2] << 8));
+    TEST_ASSERT_EQUAL(0, mcs_frame_count(2));
+}
+
+void test_mcs_splits_counts_across_boundary()
+{
+    gmState.acq_mode = ACQ_MCS;
+    gmConfigureMcs(1000);
+    gmStartAcquisition();
+    Serial.clear();
+
+    set_mock_micros(100);
+    gmISR(); // baseline
+    set_mock_micros(500);
+    gmISR(); // bin 0
+    set_mock_micros(1200);
+    gmISR(); // closes bin 0, counts into bin 1
+    set_mock_micros(2500);
+    gmProcessAcquisition(); // pass-level catch-up closes bin 1
+
+    TEST_ASSERT_EQUAL(2 * MCS_FRAME_LEN, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL(1, mcs_frame_count(0));
+    TEST_ASSERT_EQUAL(1, mcs_frame_count(1));
+    TEST_ASSERT_EQUAL(1, Serial.bytes[MCS_FRAME_LEN + 1] |
+                             (Serial.bytes[MCS_FRAME_LEN + 2] << 8));
+}
+
+// ── RNG entropy extraction (ACQ_RNG) ──────────────────────────────────────────
+// Frame: [0xAF, 16 entropy bytes, 0x55].  Bits pack MSB first; a frame needs
+// 128 output bits, so the tests drive the pipeline with a few hundred pulses
+// of controlled delta parity (draining periodically to keep the ring shallow).
+
+void test_rng_von_neumann_frame_from_alternating_lsbs()
+{
+    gmState.acq_mode = ACQ_RNG;
+    gmConfigureRng(RNG_VN);
+    gmStartAcquisition();
+    Serial.clear();
+
+    // Delta LSB sequence 1,0,1,0,… — every von Neumann pair is (1,0) → 1.
+    // 256 deltas → 128 ones → 16 bytes of 0xFF → exactly one frame.
+    unsigned long t = 0;
+    set_mock_micros(t);
+    gmISR(); // baseline
+    for (int i = 0; i < 256; i++)
+    {
+        t += (i % 2 == 0) ? 21 : 20;
+        set_mock_micros(t);
+        gmISR();
+        if (i % 64 == 63)
+            gmProcessAcquisition();
+    }
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(RNG_FRAME_LEN, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(RNG_MARKER_BYTE, Serial.bytes[0]);
+    for (int i = 1; i <= RNG_PAYLOAD_BYTES; i++)
+        TEST_ASSERT_EQUAL_HEX8(0xFF, Serial.bytes[i]);
+    TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes[RNG_FRAME_LEN - 1]);
+    TEST_ASSERT_EQUAL(256, (int)acqStats.nPoints);
+}
+
+void test_rng_von_neumann_discards_equal_pairs()
+{
+    gmState.acq_mode = ACQ_RNG;
+    gmConfigureRng(RNG_VN);
+    gmStartAcquisition();
+    Serial.clear();
+
+    // All-even deltas — every pair is (0,0), so no bit survives debiasing.
+    unsigned long t = 0;
+    set_mock_micros(t);
+    gmISR(); // baseline
+    for (int i = 0; i < 40; i++)
+    {
+        t += 20;
+        set_mock_micros(t);
+        gmISR();
+    }
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(0, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL(40, (int)acqStats.nPoints); // stats still see every event
+}
+
+void test_rng_parity_emits_one_bit_per_event()
+{
+    gmState.acq_mode = ACQ_RNG;
+    gmConfigureRng(RNG_PARITY);
+    gmStartAcquisition();
+    Serial.clear();
+
+    // Low-byte parities alternate 1,0 (21 → three set bits, 20 → two), so
+    // 128 deltas pack into 16 bytes of 0b10101010.
+    unsigned long t = 0;
+    set_mock_micros(t);
+    gmISR(); // baseline
+    for (int i = 0; i < 128; i++)
+    {
+        t += (i % 2 == 0) ? 21 : 20;
+        set_mock_micros(t);
+        gmISR();
+        if (i % 64 == 63)
+            gmProcessAcquisition();
+    }
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(RNG_FRAME_LEN, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(RNG_MARKER_BYTE, Serial.bytes[0]);
+    for (int i = 1; i <= RNG_PAYLOAD_BYTES; i++)
+        TEST_ASSERT_EQUAL_HEX8(0xAA, Serial.bytes[i]);
+    TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes[RNG_FRAME_LEN - 1]);
+}
+
+// ── Second capture channel (CONF:CH2) ─────────────────────────────────────────
+// Ch2 frames use marker 0xA9 with the same fixed 6-byte layout.  With CH2 on,
+// both channels seed their delta baseline from the stream-start tick, so each
+// channel's first frame is its offset from the shared start of stream.
+
+static uint32_t fixed_frame_delta(int offset)
+{
+    return (uint32_t)Serial.bytes[offset + 1] |
+           ((uint32_t)Serial.bytes[offset + 2] << 8) |
+           ((uint32_t)Serial.bytes[offset + 3] << 16) |
+           ((uint32_t)Serial.bytes[offset + 4] << 24);
+}
+
+void test_ch2_frames_tagged_and_on_shared_timeline()
+{
+    gmState.ch2_enabled = true;
+    set_mock_micros(0);
+    gmStartAcquisition();
+    Serial.clear();
+
+    set_mock_micros(1000);
+    gmISR(); // ch1, offset 1000 from start
+    set_mock_micros(1500);
+    gmISR2(); // ch2, offset 1500 from start
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition(); // deadline flush
+
+    TEST_ASSERT_EQUAL(12, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(0xAA, Serial.bytes[0]);
+    TEST_ASSERT_EQUAL(1000, fixed_frame_delta(0));
+    TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes[5]);
+    TEST_ASSERT_EQUAL_HEX8(CH2_MARKER_BYTE, Serial.bytes[6]);
+    TEST_ASSERT_EQUAL(1500, fixed_frame_delta(6));
+    TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes[11]);
+    TEST_ASSERT_EQUAL(2, (int)acqStats.nPoints);
+}
+
+void test_ch2_deltas_are_per_channel()
+{
+    gmState.ch2_enabled = true;
+    set_mock_micros(0);
+    gmStartAcquisition();
+    Serial.clear();
+
+    set_mock_micros(1000);
+    gmISR2();
+    set_mock_micros(4000);
+    gmISR(); // ch1 delta = 4000 (from start), not 3000 (from the ch2 pulse)
+    set_mock_micros(6000);
+    gmISR2(); // ch2 delta = 5000 (from its own previous pulse)
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(18, (int)Serial.bytes.size());
+    // Drain order is ch1 then ch2 within a pass.
+    TEST_ASSERT_EQUAL_HEX8(0xAA, Serial.bytes[0]);
+    TEST_ASSERT_EQUAL(4000, fixed_frame_delta(0));
+    TEST_ASSERT_EQUAL_HEX8(CH2_MARKER_BYTE, Serial.bytes[6]);
+    TEST_ASSERT_EQUAL(1000, fixed_frame_delta(6));
+    TEST_ASSERT_EQUAL_HEX8(CH2_MARKER_BYTE, Serial.bytes[12]);
+    TEST_ASSERT_EQUAL(5000, fixed_frame_delta(12));
+}
+
+void test_ch2_ring_ignored_when_disabled()
+{
+    set_mock_micros(0);
+    gmStartAcquisition();
+    Serial.clear();
+
+    set_mock_micros(1000);
+    gmISR2(); // lands in the ch2 ring but must never be drained
+    set_mock_micros(2000);
+    gmISR2();
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(0, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL(0, (int)acqStats.nPoints);
+}
+
+// ── Live stats sideband (CONF:STATS) ──────────────────────────────────────────
+// Frame: [0xAB, nPoints LE32, overflows LE32, txDrops LE32, debounced LE32,
+//         ringFillPeak LE16, subDead LE16, nearDead LE16, 0x55] — 24 bytes,
+// once per second.
+
+void test_stats_sideband_off_by_default()
+{
+    gmStartAcquisition();
+    Serial.clear();
+
+    set_mock_micros(0);
+    gmISR();
+    set_mock_micros(500);
+    gmISR();
+    set_mock_millis(STATS_EMIT_INTERVAL_MS + 1);
+    gmProcessAcquisition();
+    set_mock_millis(STATS_EMIT_INTERVAL_MS + TX_FLUSH_DEADLINE_MS + 2);
+    gmProcessAcquisition();
+
+    // One data packet only — no 0xAB frame appears unsolicited.
+    TEST_ASSERT_EQUAL(6, (int)Serial.bytes.size());
+}
+
+void test_stats_frame_layout()
+{
+    gmState.stats_sideband = true;
+    gmStartAcquisition();
+    Serial.clear();
+
+    // 3 pulses → 2 data packets; all 3 sit in the ring when the drain starts.
+    set_mock_micros(0);
+    gmISR();
+    set_mock_micros(500);
+    gmISR();
+    set_mock_micros(1000);
+    gmISR();
+    set_mock_millis(STATS_EMIT_INTERVAL_MS + 1);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(2 * 6 + STATS_FRAME_LEN, (int)Serial.bytes.size());
+    const int b = 2 * 6; // stats frame starts after the data packets
+    TEST_ASSERT_EQUAL_HEX8(STATS_MARKER_BYTE, Serial.bytes[b]);
+    TEST_ASSERT_EQUAL(2, Serial.bytes[b + 1]);  // nPoints LSB
+    TEST_ASSERT_EQUAL(0, Serial.bytes[b + 5]);  // overflows
+    TEST_ASSERT_EQUAL(0, Serial.bytes[b + 9]);  // txDrops
+    TEST_ASSERT_EQUAL(0, Serial.bytes[b + 13]); // debounced
+    TEST_ASSERT_EQUAL(3, Serial.bytes[b + 17]); // ringFillPeak LSB
+    TEST_ASSERT_EQUAL(0, Serial.bytes[b + 18]); // ringFillPeak MSB
+    TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes[b + 23]);
+}
+
+void test_stats_frame_not_emitted_before_interval()
+{
+    gmState.stats_sideband = true;
+    gmStartAcquisition();
+    Serial.clear();
+
+    set_mock_micros(0);
+    gmISR();
+    set_mock_micros(500);
+    gmISR();
+    gmProcessAcquisition(); // millis still 0 — before the first emit interval
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition(); // held packet flushes — still no stats frame
+
+    TEST_ASSERT_EQUAL(6, (int)Serial.bytes.size());
+}
+
+// ── Ring watermark degradation (CONF:WMARK) ───────────────────────────────────
+// Degrade frame: [0xB0, skipped LE16, delta LE32, 4 reserved, 0x55] — 12 bytes.
+// Integral check: every suppressed event appears in some frame's skipped
+// field, every emitted event carries its own delta.
+
+void test_backlog_below_watermark_streams_normally()
+{
+    gmConfigureWatermark(64);
+    gmStartAcquisition();
+    Serial.clear();
+
+    unsigned long t = 0;
+    for (int i = 0; i < 50; i++) // backlog 50 < 64 at drain start
+    {
+        set_mock_micros(t);
+        gmISR();
+        t += 1000;
+    }
+    gmProcessAcquisition();
+    TEST_ASSERT_FALSE(gmDegradeActive());
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(49 * 6, (int)Serial.bytes.size()); // plain packets
+    TEST_ASSERT_EQUAL_HEX8(0xAA, Serial.bytes[0]);
+
+    gmConfigureWatermark(0); // restore the default for later tests
+}
+
+void test_watermark_degrades_and_preserves_integral_count()
+{
+    gmConfigureWatermark(64);
+    gmStartAcquisition();
+    Serial.clear();
+
+    // 100 pulses queued before the first drain — backlog 100 crosses the
+    // watermark, so the pass runs degraded: 99 deltas → 12 frames of 8
+    // events each, 3 suppressed events still pending at pass end.
+    unsigned long t = 0;
+    for (int i = 0; i < 100; i++)
+    {
+        set_mock_micros(t);
+        gmISR();
+        t += 1000;
+    }
+    gmProcessAcquisition();
+    TEST_ASSERT_TRUE(gmDegradeActive());
+
+    // Next pass sees an empty ring — below half the watermark — so the mode
+    // exits with a skipped-only summary frame, then the deadline flush runs.
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+    TEST_ASSERT_FALSE(gmDegradeActive());
+
+    TEST_ASSERT_EQUAL(13 * DEGRADE_FRAME_LEN, (int)Serial.bytes.size());
+
+    // Frame 0: 7 skipped, delta of the 8th event (1000 µs).
+    TEST_ASSERT_EQUAL_HEX8(DEGRADE_MARKER_BYTE, Serial.bytes[0]);
+    TEST_ASSERT_EQUAL(7, Serial.bytes[1] | (Serial.bytes[2] << 8));
+    TEST_ASSERT_EQUAL(1000, (uint32_t)Serial.bytes[3] |
+                                ((uint32_t)Serial.bytes[4] << 8) |
+                                ((uint32_t)Serial.bytes[5] << 16) |
+                                ((uint32_t)Serial.bytes[6] << 24));
+    TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes[11]);
+
+    // Exit summary frame: 3 skipped, delta 0, and the integral adds up.
+    int total = 0;
+    for (int f = 0; f < 13; f++)
+    {
+        const int b = f * DEGRADE_FRAME_LEN;
+        TEST_ASSERT_EQUAL_HEX8(DEGRADE_MARKER_BYTE, Serial.bytes[b]);
+        int skipped = Serial.bytes[b + 1] | (Serial.bytes[b + 2] << 8);
+        bool has_delta = Serial.bytes[b + 3] || Serial.bytes[b + 4] ||
+                         Serial.bytes[b + 5] || Serial.bytes[b + 6];
+        total += skipped + (has_delta ? 1 : 0);
+    }
+    TEST_ASSERT_EQUAL(3, Serial.bytes[12 * DEGRADE_FRAME_LEN + 1]);
+    TEST_ASSERT_EQUAL(99, total);
+    TEST_ASSERT_EQUAL(99, (int)acqStats.nPoints); // stats saw every event too
+
+    gmConfigureWatermark(0); // restore the default for later tests
+}
+
+// ── Dead-time classification (CONF:DEAD) ──────────────────────────────────────
+// Natively TICKS_PER_US == 1, so the default τ = 200 ticks = 200 µs; bands are
+// subDead < τ ≤ nearDead < 2τ ≤ unclassified.
+
+void test_deadtime_classifier_default_thresholds()
+{
+    gmStartAcquisition();
+
+    set_mock_micros(0);
+    gmISR(); // baseline
+    set_mock_micros(50);
+    gmISR(); // delta 50 — above debounce, below τ → subDead
+    set_mock_micros(350);
+    gmISR(); // delta 300 — in [200, 400) → nearDead
+    set_mock_micros(1150);
+    gmISR(); // delta 800 — beyond 2τ → unclassified
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(3, (int)acqStats.nPoints);
+    TEST_ASSERT_EQUAL(1, (int)acqStats.subDead);
+    TEST_ASSERT_EQUAL(1, (int)acqStats.nearDead);
+    TEST_ASSERT_EQUAL(0, (int)acqStats.debounced);
+}
+
+void test_deadtime_classifier_configurable()
+{
+    gmConfigureDeadtime(100);
+    gmStartAcquisition();
+
+    set_mock_micros(0);
+    gmISR(); // baseline
+    set_mock_micros(150);
+    gmISR(); // delta 150 — in [100, 200) → nearDead
+    set_mock_micros(300);
+    gmISR(); // delta 150 again → nearDead
+    set_mock_micros(350);
+    gmISR(); // delta 50 → subDead
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(1, (int)acqStats.subDead);
+    TEST_ASSERT_EQUAL(2, (int)acqStats.nearDead);
+    TEST_ASSERT_EQUAL(100, gmDeadtimeUs());
+
+    gmConfigureDeadtime(DEFAULT_DEADTIME_US); // restore for later tests
+}
+
+void test_deadtime_counters_ride_stats_sideband()
+{
+    gmState.stats_sideband = true;
+    gmStartAcquisition();
+    Serial.clear();
+
+    set_mock_micros(0);
+    gmISR(); // baseline
+    set_mock_micros(50);
+    gmISR(); // subDead
+    set_mock_micros(350);
+    gmISR(); // nearDead
+    set_mock_millis(STATS_EMIT_INTERVAL_MS + 1);
+    gmProcessAcquisition();
+
+    const int b = 2 * 6; // stats frame starts after the two data packets
+    TEST_ASSERT_EQUAL(2 * 6 + STATS_FRAME_LEN, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL(1, Serial.bytes[b + 19]); // subDead LSB
+    TEST_ASSERT_EQUAL(0, Serial.bytes[b + 20]);
+    TEST_ASSERT_EQUAL(1, Serial.bytes[b + 21]); // nearDead LSB
+    TEST_ASSERT_EQUAL(0, Serial.bytes[b + 22]);
+}
+
+// ── Drain-cycle profiler (DIAG:PROF?) ─────────────────────────────────────────
+
+void test_profiler_bins_drain_gaps()
+{
+    gmStartAcquisition();
+
+    // Drain passes at 0, 1000 and 1003 µs → gaps of 1000 µs (bin 9, since
+    // 2^9 ≤ 1000 < 2^10) and 3 µs (bin 1).
+    set_mock_micros(0);
+    gmProcessAcquisition();
+    set_mock_micros(1000);
+    gmProcessAcquisition();
+    set_mock_micros(1003);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(1, gmProfile().bins[9]);
+    TEST_ASSERT_EQUAL(1, gmProfile().bins[1]);
+    TEST_ASSERT_EQUAL(1000, gmProfile().maxGapUs);
+}
+
+void test_profiler_tracks_ring_and_tx_peaks()
+{
+    gmStartAcquisition();
+    Serial.clear();
+
+    // Five pulses queued before the first drain → backlog of 5 at drain start;
+    // the four resulting packets (24 bytes) peak _txLen at flush time.
+    for (int i = 0; i < 5; i++)
+    {
+        set_mock_micros((i + 1) * 1000);
+        gmISR();
+    }
+    gmProcessAcquisition();
+    set_mock_millis(TX_FLUSH_DEADLINE_MS + 1);
+    gmProcessAcquisition();
+
+    TEST_ASSERT_EQUAL(5, gmProfile().ringPeak);
+    TEST_ASSERT_EQUAL(24, gmProfile().txLenPeak);
+}
+
+void test_profiler_reset_on_start()
+{
+    gmStartAcquisition();
+    set_mock_micros(0);
+    gmProcessAcquisition();
+    set_mock_micros(500);
+    gmProcessAcquisition();
+    TEST_ASSERT_TRUE(gmProfile().maxGapUs > 0);
+
+    gmStopAcquisition();
+    gmStartAcquisition(); // new run — profile starts clean
+    TEST_ASSERT_EQUAL(0, gmProfile().maxGapUs);
+    TEST_ASSERT_EQUAL(0, gmProfile().ringPeak);
+    TEST_ASSERT_EQUAL(0, gmProfile().txLenPeak);
+}
+
+// ── Self-test sweep ───────────────────────────────────────────────────────────
+// gmSelfTestTrial() needs real time (it paces on the live counter), so only the
+// sweep logic is exercised here, against fake trial functions with a known
+// ceiling.
+
+static uint32_t _fakeCeilingHz = 0;
+static bool fake_trial_with_ceiling(uint32_t rate_hz) { return rate_hz <= _fakeCeilingHz; }
+static bool fake_trial_always_fails(uint32_t) { return false; }
+static bool fake_trial_always_passes(uint32_t) { return true; }
+
+void test_selftest_sweep_converges_on_ceiling()
+{
+    _fakeCeilingHz = 12000;
+    uint32_t best = gmSelfTestSweep(fake_trial_with_ceiling);
+    // Must land at or just below the ceiling (refinement stops at ~6 %).
+    TEST_ASSERT_TRUE(best <= 12000);
+    TEST_ASSERT_TRUE(best >= 11000);
+}
+
+void test_selftest_sweep_all_rates_fail_returns_zero()
+{
+    TEST_ASSERT_EQUAL(0, (int)gmSelfTestSweep(fake_trial_always_fails));
+}
+
+void test_selftest_sweep_clean_to_cap_returns_highest_step()
+{
+    // Doubling from SELFTEST_RATE_MIN_HZ: the last step within the cap wins.
+    uint32_t best = gmSelfTestSweep(fake_trial_always_passes);
+    TEST_ASSERT_TRUE(best <= SELFTEST_RATE_MAX_HZ);
+    TEST_ASSERT_TRUE(best * 2 > SELFTEST_RATE_MAX_HZ);
+}
+
+// ── End-of-period detection ───────────────────────────────────────────────────
+
+void test_arm_eop_sets_state()
+{
+    gmStartAcquisition(); // sets acqStats.startMs = millis() = 0
+    gmArmEndOfPeriod(10000); // 10 s period
+    TEST_ASSERT_TRUE(gmState.endPeriodArmed);
+}
+
+void test_disarm_eop_clears_state()
+{
+    gmStartAcquisition();
+    gmArmEndOfPeriod(10000);
+    gmDisarmEndOfPeriod();
+    TEST_ASSERT_FALSE(gmState.endPeriodArmed);
+}
+
+void test_eop_not_reached_early()
+{
+    // Armed, but millis is 0 and no Serial1 data → not reached yet.
+    gmStartAcquisition();
+    gmArmEndOfPeriod(10000);
+    set_mock_millis(100); // 0.1 s — far before period
+    TEST_ASSERT_FALSE(gmEndOfPeriodReached());
+}
+
+void test_eop_reached_timer_fallback()
+{
+    // millis exceeds period + margin → timer fallback fires.
+    gmStartAcquisition(); // startMs = 0
+    gmArmEndOfPeriod(1000); // 1 s period
+    set_mock_millis(1000 + GM_END_PERIOD_MARGIN_MS + 1);
+    TEST_ASSERT_TRUE(gmEndOfPeriodReached());
+}
+
+void test_eop_reached_serial1_after_half_period()
+{
+    // Serial1 has data AND elapsed > period/2 → device-authoritative trigger.
+    gmStartAcquisition(); // startMs = 0
+    gmArmEndOfPeriod(1000);
+    set_mock_millis(600); // > 500 ms (half of 1 s)
+    Serial1.setInput("42\n"); // e1 result line
+    TEST_ASSERT_TRUE(gmEndOfPeriodReached());
+}
+
+void test_eop_not_triggered_serial1_before_half_period()
+{
+    // Serial1 has data but elapsed < period/2 — this is the s1 echo guard.
+    gmStartAcquisition(); // startMs = 0
+    gmArmEndOfPeriod(1000);
+    set_mock_millis(200); // < 500 ms (half of 1 s)
+    Serial1.setInput("42\n");
+    TEST_ASSERT_FALSE(gmEndOfPeriodReached());
+    // The ignored bytes must be drained, not deferred: left in the RX buffer
+    // they would fire the trigger as soon as the half-period guard lifts.
+    TEST_ASSERT_EQUAL(0, Serial1.available());
+    set_mock_millis(600); // past half period, no NEW Serial1 data
+    TEST_ASSERT_FALSE(gmEndOfPeriodReached());
+}
+
+// ── Per-period sentinels (repeat mode) ────────────────────────────────────────
+// Sentinel: [0xEE, 0xEE, 0xEE, period_idx LE16, 0x55] — never six 0xEE.
+
+void test_period_marker_format_and_index()
+{
+    gmStartAcquisition();
+    gmArmEndOfPeriod(1000);
+    Serial.clear();
+
+    gmEmitPeriodMarker(); // period 0 just completed
+    gmRearmEndOfPeriod();
+    gmEmitPeriodMarker(); // period 1
+
+    TEST_ASSERT_EQUAL(12, (int)Serial.bytes.size());
+    for (int i = 0; i < 3; i++)
+        TEST_ASSERT_EQUAL_HEX8(0xEE, Serial.bytes[i]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, Serial.bytes[3]); // idx 0, LSB
+    TEST_ASSERT_EQUAL_HEX8(0x00, Serial.bytes[4]);
+    TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes[5]); // ≠ 0xEE — no end-marker alias
+    TEST_ASSERT_EQUAL_HEX8(0x01, Serial.bytes[6 + 3]); // idx 1 after re-arm
+}
+
+void test_rearm_resets_period_timer()
+{
+    gmStartAcquisition(); // startMs = 0
+    gmArmEndOfPeriod(1000);
+    set_mock_millis(1000 + GM_END_PERIOD_MARGIN_MS + 1);
+    TEST_ASSERT_TRUE(gmEndOfPeriodReached());
+
+    gmRearmEndOfPeriod(); // new period starts at the current millis
+    TEST_ASSERT_TRUE(gmState.endPeriodArmed);
+    TEST_ASSERT_FALSE(gmEndOfPeriodReached());
+
+    set_mock_millis(2 * (1000 + GM_END_PERIOD_MARGIN_MS + 1));
+    TEST_ASSERT_TRUE(gmEndOfPeriodReached());
+}
+
+void test_emit_end_marker_writes_six_ee_then_trailer()
+{
+    // gmEmitEndMarker must write 0xEE×6 to Serial after flushing any pending
+    // data — nothing more by default; the 0xB1 trailer only follows when
+    // CONF:TRAIL is enabled (a parser that does not know it would misframe
+    // its bytes as data).
+    gmStartAcquisition();
+    Serial.clear(); // discard start marker
+    gmEmitEndMarker();
+    TEST_ASSERT_EQUAL(6, (int)Serial.bytes.size());
+    for (int i = 0; i < 6; i++)
+        TEST_ASSERT_EQUAL_HEX8(0xEE, Serial.bytes[i]);
+
+    gmState.session_trailer = true;
+    Serial.clear();
+    gmEmitEndMarker();
+    TEST_ASSERT_EQUAL(6 + TRAILER_FRAME_LEN, (int)Serial.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(TRAILER_MARKER_BYTE, Serial.bytes[6]);
+    TEST_ASSERT_EQUAL_HEX8(0x55, Serial.bytes.back());
+}
+
+void test_session_trailer_describes_run()
+{
+    gmState.session_trailer = true; // opt-in — off by default
+    gmStartAcquisition();           // startMs = 0 under the mocked clock
+
+    // Three pulses → two accepted 1000 µs deltas, then end the run at 5 s.
+    for (int i = 0; i < 3; i++)
+    {
+        set_mock_micros((uint32_t)(i + 1) * 1000UL);
+        gmISR();
+    }
+    gmProcessAcquisition();
+    set_mock_millis(5000);
+    gmProcessAcquisition(); // deadline flush — drain the held packets first
+    Serial.clear();
+    gmEmitEndMarker();
+
+    const uint8_t *t = &Serial.bytes[6]; // trailer starts after the sentinel
+    TEST_ASSERT_EQUAL(TRAILER_FORMAT_VERSION, t[1]);
+    TEST_ASSERT_EQUAL(ENC_FIXED, t[2]);
+    TEST_ASSERT_EQUAL(ACQ_STREAM, t[3]);
+    TEST_ASSERT_EQUAL(TICKS_PER_US, t[4] | (t[5] << 8));
+    // Duration falls back to millis() — endMs is not set until stop.
+    TEST_ASSERT_EQUAL(5000, (uint32_t)t[6] | ((uint32_t)t[7] << 8) |
+                                ((uint32_t)t[8] << 16) | ((uint32_t)t[9] << 24));
+    TEST_ASSERT_EQUAL(2, t[10]); // nPoints
+    TEST_ASSERT_EQUAL(0, t[14]); // debounced
+    TEST_ASSERT_EQUAL(0, t[18]); // overflows
+    TEST_ASSERT_EQUAL(0, t[22]); // txDrops
+
+    gmStopAcquisition();
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_start_sets_streaming_flag);
+    RUN_TEST(test_start_sends_six_ff_marker);
+    RUN_TEST(test_epoch_packet_follows_start_marker_when_enabled);
+    RUN_TEST(test_stop_clears_streaming_flag);
+    RUN_TEST(test_reset_clears_stats);
+    RUN_TEST(test_moments_match_known_dataset);
+    RUN_TEST(test_moments_updated_by_drain_loop);
+    RUN_TEST(test_first_isr_produces_no_packet);
+    RUN_TEST(test_two_pulses_produce_one_packet);
+    RUN_TEST(test_packet_framing_bytes);
+    RUN_TEST(test_packet_delta_little_endian);
+    RUN_TEST(test_delta_at_debounce_threshold_filtered);
+    RUN_TEST(test_delta_just_above_debounce_passes);
+    RUN_TEST(test_multiple_valid_pulses);
+    RUN_TEST(test_burst_across_batches_emits_all_packets);
+    // Rate-adaptive flush deadline
+    RUN_TEST(test_partial_batch_held_until_deadline);
+    RUN_TEST(test_full_batch_flushes_without_deadline);
+    RUN_TEST(test_ring_buffer_overflow_no_crash);
+    RUN_TEST(test_isr_overflow_counted);
+    RUN_TEST(test_isr_overflow_does_not_overwrite_buffer);
+    RUN_TEST(test_reset_clears_overflow_count);
+    // Varint encoding
+    RUN_TEST(test_varint_single_byte_delta);
+    RUN_TEST(test_varint_two_byte_delta);
+    RUN_TEST(test_varint_resync_marker_emitted_after_interval);
+    // Sequenced frames
+    RUN_TEST(test_seq_frame_layout_and_crc);
+    RUN_TEST(test_seq_counter_increments_per_packet);
+    RUN_TEST(test_seq_counter_resets_on_start);
+    // On-device histogram
+    RUN_TEST(test_hist_mode_sends_no_per_event_packets);
+    RUN_TEST(test_hist_frame_emitted_after_interval);
+    RUN_TEST(test_hist_linear_binning);
+    RUN_TEST(test_hist_stop_emits_final_snapshot);
+    // 64-bit wrap extension
+    RUN_TEST(test_event_latched_before_wrap_drained_after);
+    RUN_TEST(test_gap_across_one_wrap_measured_exactly);
+    RUN_TEST(test_gap_across_two_wraps_saturates);
+    // Burst capture
+    RUN_TEST(test_burst_capture_no_tx_until_target);
+    RUN_TEST(test_burst_playback_and_end_marker_at_target);
+    RUN_TEST(test_burst_target_clamped_to_buffer);
+    RUN_TEST(test_mcs_counts_events_per_bin);
+    RUN_TEST(test_mcs_emits_empty_bins);
+    RUN_TEST(test_mcs_splits_counts_across_boundary);
+
+    RUN_TEST(test_rng_von_neumann_frame_from_alternating_lsbs);
+    RUN_TEST(test_rng_von_neumann_discards_equal_pairs);
+    RUN_TEST(test_rng_parity_emits_one_bit_per_event);
+
+    RUN_TEST(test_ch2_frames_tagged_and_on_shared_timeline);
+    RUN_TEST(test_ch2_deltas_are_per_channel);
+    RUN_TEST(test_ch2_ring_ignored_when_disabled);
+    // Live stats sideband
+    RUN_TEST(test_stats_sideband_off_by_default);
+    RUN_TEST(test_stats_frame_layout);
+    RUN_TEST(test_stats_frame_not_emitted_before_interval);
+    // Ring watermark degradation
+    RUN_TEST(test_backlog_below_watermark_streams_normally);
+    RUN_TEST(test_watermark_degrades_and_preserves_integral_count);
+    // Dead-time classification
+    RUN_TEST(test_deadtime_classifier_default_thresholds);
+    RUN_TEST(test_deadtime_classifier_configurable);
+    RUN_TEST(test_deadtime_counters_ride_stats_sideband);
+    RUN_TEST(test_profiler_bins_drain_gaps);
+    RUN_TEST(test_profiler_tracks_ring_and_tx_peaks);
+    RUN_TEST(test_profiler_reset_on_start);
+    // Self-test sweep
+    RUN_TEST(test_selftest_sweep_converges_on_ceiling);
+    RUN_TEST(test_selftest_sweep_all_rates_fail_returns_zero);
+    RUN_TEST(test_selftest_sweep_clean_to_cap_returns_highest_step);
     // End-of-period detection
     RUN_TEST(test_arm_eop_sets_state);
     RUN_TEST(test_disarm_eop_clears_state);
@@ -380,6 +1592,10 @@ int main()
     RUN_TEST(test_eop_reached_timer_fallback);
     RUN_TEST(test_eop_reached_serial1_after_half_period);
     RUN_TEST(test_eop_not_triggered_serial1_before_half_period);
-    RUN_TEST(test_emit_end_marker_writes_six_ee);
+    // Per-period sentinels (repeat mode)
+    RUN_TEST(test_period_marker_format_and_index);
+    RUN_TEST(test_rearm_resets_period_timer);
+    RUN_TEST(test_emit_end_marker_writes_six_ee_then_trailer);
+    RUN_TEST(test_session_trailer_describes_run);
     return UNITY_END();
 }
@@ -0,0 +1,184 @@
+// Deterministic pulse-train simulation harness.  Replays fixed-rate and
+// Poisson trains through the full pipeline — gmISR() → ring →
+// gmProcessAcquisition() → txFlush() — while modelling host back-pressure
+// with the mock's txSpace, and checks the loss accounting (overflows,
+// txDrops, debounced) against exact expectations.  Throughput changes can be
+// validated here natively before flashing the lab boards.
+#include <unity.h>
+
+#include <math.h>
+
+#include "arduino_mock.h"
+#include "../../src/state.cpp"
+#include "../../src/gm_core.cpp"
+
+void setUp()
+{
+    Serial.clear();
+    Serial1.clear();
+    acqStats.reset();
+    gmState = GmState{};
+    gmResetAcquisition();
+    set_mock_micros(0);
+    set_mock_millis(0);
+}
+
+void tearDown() {}
+
+// ── Harness ───────────────────────────────────────────────────────────────────
+
+// xorshift32 with a fixed seed — every run of the suite sees the same train.
+static uint32_t _simRand = 0;
+
+static uint32_t simRand()
+{
+    uint32_t x = _simRand;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    _simRand = x;
+    return x;
+}
+
+// Exponential inter-arrival time with the given mean — the defining property
+// of a Poisson pulse train.  Clamped to ≥ 1 µs so time always advances.
+static uint32_t simExpDelta(double mean_us)
+{
+    double u = ((simRand() >> 8) + 1.0) / 16777217.0; // (0, 1]
+    double d = -mean_us * log(u);
+    return d < 1.0 ? 1 : (uint32_t)d;
+}
+
+// Drive *n_deltas* pulses after a baseline pulse at t = 0.  Every
+// *drain_every* pulses the host is modelled: txSpace is set to *tx_budget*
+// (the USB space the host freed since the last pass) and one drain pass runs.
+// fixed_delta_us == 0 selects the Poisson train with *mean_us*.
+static void simRunTrain(int n_deltas, uint32_t fixed_delta_us, double mean_us,
+                        int drain_every, int tx_budget)
+{
+    unsigned long t = 0;
+    set_mock_micros(t);
+    gmISR(); // baseline — seeds the delta timebase, emits nothing
+    for (int i = 1; i <= n_deltas; i++)
+    {
+        t += fixed_delta_us ? fixed_delta_us : simExpDelta(mean_us);
+        set_mock_micros(t);
+        gmISR();
+        if (i % drain_every == 0)
+        {
+            Serial.txSpace = tx_budget;
+            set_mock_millis(t / 1000);
+            gmProcessAcquisition();
+        }
+    }
+    Serial.txSpace = tx_budget;
+    set_mock_millis(t / 1000);
+    gmProcessAcquisition();
+}
+
+// Final host catch-up: unlimited TX space and enough wall-clock for the
+// deadline flush, repeated until the output stops growing.
+static void simFlushAll()
+{
+    Serial.txSpace = 4096;
+    size_t before;
+    do
+    {
+        before = Serial.bytes.size();
+        set_mock_millis(millis() + TX_FLUSH_DEADLINE_MS + 1);
+        gmProcessAcquisition();
+    } while (Serial.bytes.size() > before);
+}
+
+// ── Lossless baseline ─────────────────────────────────────────────────────────
+
+void test_fixed_rate_unthrottled_is_lossless()
+{
+    gmStartAcquisition();
+    Serial.clear();
+
+    simRunTrain(5000, 1000, 0.0, 64, 4096);
+    simFlushAll();
+
+    TEST_ASSERT_EQUAL(5000, (int)acqStats.nPoints);
+    TEST_ASSERT_EQUAL(0, (int)acqStats.debounced);
+    TEST_ASSERT_EQUAL(0, (int)acqStats.overflows);
+    TEST_ASSERT_EQUAL(0, (int)acqStats.txDrops);
+    TEST_ASSERT_EQUAL(5000 * 6, (int)Serial.bytes.size());
+}
+
+void test_poisson_train_conserves_every_event()
+{
+    _simRand = 0x1234567; // fixed seed — identical train on every run
+    gmStartAcquisition();
+    Serial.clear();
+
+    simRunTrain(2000, 0, 500.0, 32, 4096);
+    simFlushAll();
+
+    // Sub-debounce inter-arrivals are expected in a Poisson train; every
+    // pulse must be accounted for as either streamed or debounced.
+    TEST_ASSERT_EQUAL(2000, (int)(acqStats.nPoints + acqStats.debounced));
+    TEST_ASSERT_EQUAL(0, (int)acqStats.overflows);
+    TEST_ASSERT_EQUAL(0, (int)acqStats.txDrops);
+    TEST_ASSERT_EQUAL((int)acqStats.nPoints * 6, (int)Serial.bytes.size());
+}
+
+// ── Loss accounting under stress ──────────────────────────────────────────────
+
+void test_undrained_ring_overflows_by_exact_count()
+{
+    gmStartAcquisition();
+    Serial.clear();
+
+    // 1500 pulses with no drain pass at all: the ring holds RING_BUF_SIZE - 1
+    // entries, every pulse beyond that increments overflows and is dropped.
+    unsigned long t = 0;
+    for (int i = 0; i < 1500; i++)
+    {
+        set_mock_micros(t);
+        gmISR();
+        t += 1000;
+    }
+    set_mock_millis(t / 1000);
+    gmProcessAcquisition();
+    simFlushAll();
+
+    TEST_ASSERT_EQUAL(1500 - (RING_BUF_SIZE - 1), (int)acqStats.overflows);
+    TEST_ASSERT_EQUAL(RING_BUF_SIZE - 2, (int)acqStats.nPoints); // minus baseline
+    TEST_ASSERT_EQUAL(0, (int)acqStats.txDrops);
+}
+
+void test_stalled_host_drops_at_tx_stage_not_ring()
+{
+    gmStartAcquisition();
+    Serial.clear();
+
+    // Host accepts nothing (txSpace 0) but the drain loop keeps running, so
+    // the ring stays shallow and the loss moves to the TX stage.  The first
+    // full batch ping-pong-swaps into the drain half before the stall bites;
+    // after that the build half fills to TX_BUF_PACKETS packets, so capacity
+    // is TX_BUF_PACKETS + TX_BATCH_PACKETS and every packet beyond that is a
+    // txDrop.
+    simRunTrain(500, 1000, 0.0, 16, 0);
+
+    const int kept = TX_BUF_PACKETS + TX_BATCH_PACKETS;
+    TEST_ASSERT_EQUAL(0, (int)acqStats.overflows);
+    TEST_ASSERT_EQUAL(500 - kept, (int)acqStats.txDrops);
+    TEST_ASSERT_EQUAL(0, (int)Serial.bytes.size()); // nothing went out yet
+
+    // Host recovers: the buffered packets flush intact, the dropped ones are
+    // gone for good.
+    simFlushAll();
+    TEST_ASSERT_EQUAL(kept * 6, (int)Serial.bytes.size());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fixed_rate_unthrottled_is_lossless);
+    RUN_TEST(test_poisson_train_conserves_every_event);
+    RUN_TEST(test_undrained_ring_overflows_by_exact_count);
+    RUN_TEST(test_stalled_host_drops_at_tx_stage_not_ring);
+    return UNITY_END();
+}
@@ -9,11 +9,21 @@
 static void reset_all()
 {
     Serial.clear();
+    Serial1.clear();         // also restores txSpace, so the flush below runs
+    if (scpiFetchPending())
+    {
+        // Finish a fetch a previous test left open — the state machine is
+        // static and would otherwise leak a -213 into the next test.
+        Serial1.setInput("\n");
+        scpiService();
+    }
+    scpiSerial1Service();    // flush lines a previous test left queued
     Serial1.clear();
     errorQueue.clear();
     acqStats.reset();
     gmState = GmState{};
     gmResetAcquisition();
+    scpiHwCacheInvalidate();
     set_mock_millis(0);
     set_mock_micros(0);
 }
@@ -226,18 +236,37 @@ void test_init_infinite_time_does_not_arm_eop()
     TEST_ASSERT_TRUE(found_e0);
 }
 
-// Finite time but repeat on → INIT sends e0 and does NOT arm.
-void test_init_repeat_mode_does_not_arm_eop()
+// Finite time + repeat on → INIT also sends e1 and arms: loop() emits a
+// per-period sentinel and re-arms instead of stopping at the first period.
+void test_init_repeat_mode_arms_eop_too()
 {
     gmState.counting_time_mode = 2; // 10 s
     gmState.repeat = true;
     scpiDispatch("INIT");
-    TEST_ASSERT_FALSE(gmState.endPeriodArmed);
-    bool found_e0 = false;
+    TEST_ASSERT_TRUE(gmState.endPeriodArmed);
+    bool found_e1 = false;
     for (const auto &line : Serial1.lines)
-        if (line == "e0")
-            found_e0 = true;
-    TEST_ASSERT_TRUE(found_e0);
+        if (line == "e1")
+            found_e1 = true;
+    TEST_ASSERT_TRUE(found_e1);
+}
+
+// Per-period 0xEE sentinels are only unambiguous in framed encodings, so
+// repeat-mode INIT must refuse to start a varint stream.
+void test_init_rejects_repeat_mode_under_varint()
+{
+    gmState.counting_time_mode = 2; // 10 s
+    gmState.repeat = true;
+    gmState.encoding = ENC_VARINT;
+    scpiDispatch("INIT");
+    TEST_ASSERT_FALSE(gmState.streaming);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+    TEST_ASSERT_EQUAL(0, (int)Serial1.lines.size()); // no s1/e1 went out
+
+    gmState.encoding = ENC_FIXED; // framed — same configuration is fine
+    scpiDispatch("INIT");
+    TEST_ASSERT_TRUE(gmState.streaming);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
 }
 
 // ABOR sends e0 and clears endPeriodArmed.
@@ -383,8 +412,121 @@ void test_conf_str_query()
     TEST_ASSERT_EQUAL_STRING("2", Serial.lastLine().c_str());
 }
 
+// ── CONF:ENC ──────────────────────────────────────────────────────────────────
+
+void test_conf_enc_set_varint()
+{
+    scpiDispatch("CONF:ENC VARINT");
+    TEST_ASSERT_EQUAL(ENC_VARINT, gmState.encoding);
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+    // Arduino-local setting — nothing may be sent to the GM counter hardware.
+    TEST_ASSERT_EQUAL(0, (int)Serial1.lines.size());
+}
+
+void test_conf_enc_set_seq()
+{
+    scpiDispatch("CONF:ENC SEQ");
+    TEST_ASSERT_EQUAL(ENC_SEQ, gmState.encoding);
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+}
+
+void test_conf_enc_query()
+{
+    gmState.encoding = ENC_VARINT;
+    scpiDispatch("CONF:ENC?");
+    TEST_ASSERT_EQUAL_STRING("1", Serial.lastLine().c_str());
+}
+
+void test_conf_enc_rejected_while_streaming()
+{
+    scpiDispatch("INIT");
+    scpiDispatch("CONF:ENC VARINT");
+    TEST_ASSERT_EQUAL(ENC_FIXED, gmState.encoding);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
+void test_conf_enc_invalid_param_pushes_error()
+{
+    scpiDispatch("CONF:ENC 7");
+    TEST_ASSERT_EQUAL(ENC_FIXED, gmState.encoding);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
+// ── CONF:ACQ / CONF:HIST ──────────────────────────────────────────────────────
+
+void test_conf_acq_set_hist()
+{
+    scpiDispatch("CONF:ACQ HIST");
+    TEST_ASSERT_EQUAL(ACQ_HIST, gmState.acq_mode);
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+}
+
+void test_conf_acq_query()
+{
+    gmState.acq_mode = ACQ_HIST;
+    scpiDispatch("CONF:ACQ?");
+    TEST_ASSERT_EQUAL_STRING("1", Serial.lastLine().c_str());
+}
+
+void test_conf_acq_rejected_while_streaming()
+{
+    scpiDispatch("INIT");
+    scpiDispatch("CONF:ACQ HIST");
+    TEST_ASSERT_EQUAL(ACQ_STREAM, gmState.acq_mode);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
+void test_conf_acq_burst_with_count()
+{
+    scpiDispatch("CONF:ACQ BURST,100");
+    TEST_ASSERT_EQUAL(ACQ_BURST, gmState.acq_mode);
+    TEST_ASSERT_EQUAL(100, (int)gmBurstTarget());
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+}
+
+void test_conf_acq_mcs_with_width()
+{
+    scpiDispatch("CONF:ACQ MCS,500");
+    TEST_ASSERT_EQUAL(ACQ_MCS, gmState.acq_mode);
+    TEST_ASSERT_EQUAL(500, gmMcsWidthUs());
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+}
+
+void test_conf_acq_mcs_invalid_width_pushes_error()
+{
+    scpiDispatch("CONF:ACQ MCS,0");
+    TEST_ASSERT_EQUAL(ACQ_STREAM, gmState.acq_mode);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
+void test_conf_acq_burst_invalid_count_pushes_error()
+{
+    scpiDispatch("CONF:ACQ BURST,0");
+    TEST_ASSERT_EQUAL(ACQ_STREAM, gmState.acq_mode);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
+void test_conf_hist_lin_sets_width()
+{
+    scpiDispatch("CONF:HIST LIN,250");
+    TEST_ASSERT_TRUE(gmHistogramIsLinear());
+    TEST_ASSERT_EQUAL(250 * TICKS_PER_US, gmHistogramWidthTicks());
+    scpiDispatch("CONF:HIST?");
+    TEST_ASSERT_EQUAL_STRING("LIN,250", Serial.lastLine().c_str());
+    scpiDispatch("CONF:HIST LOG"); // restore default for later tests
+}
+
+void test_conf_hist_invalid_width_pushes_error()
+{
+    scpiDispatch("CONF:HIST LIN,0");
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
 // ── FETC:STAT? ────────────────────────────────────────────────────────────────
 
+// The FETCh path is asynchronous: the handler only issues b2; scpiService()
+// (pumped from loop()) assembles and emits the reply.
+
 void test_fetc_stat_sends_b2_to_hardware()
 {
     Serial1.setInput("100,90,10,0,50,500,\n");
@@ -396,16 +538,60 @@ void test_fetc_stat_forwards_response()
 {
     Serial1.setInput("100,90,10,0,50,500,\n");
     scpiDispatch("FETC:STAT?");
+    scpiService(); // loop() pump delivers the reply
+    TEST_ASSERT_FALSE(scpiFetchPending());
     TEST_ASSERT_EQUAL_STRING("100,90,10,0,50,500,", Serial.lastLine().c_str());
 }
 
+void test_init_rejected_while_fetch_pending()
+{
+    // The b2 reply is still in flight: starting now would strand it
+    // mid-stream (scpiService is only pumped on the idle path) and skip the
+    // b1 stream-mode restore.
+    scpiDispatch("FETC:STAT?");
+    scpiDispatch("INIT");
+    TEST_ASSERT_FALSE(gmState.streaming);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+
+    Serial1.setInput("100,90,10,0,50,500,\n");
+    scpiService(); // reply delivered — the conflict is gone
+    scpiDispatch("INIT");
+    TEST_ASSERT_TRUE(gmState.streaming);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
 void test_fetc_stat_no_response_pushes_error()
 {
-    Serial1.setInput("\n"); // empty — terminates readSerial1Line immediately
+    Serial1.setInput("\n"); // empty reply line
+    scpiDispatch("FETC:STAT?");
+    scpiService();
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
+void test_fetc_stat_does_not_block_before_timeout()
+{
+    // No reply at all: the handler returns immediately and the fetch stays
+    // pending until the 300 ms deadline, leaving loop() free meanwhile.
     scpiDispatch("FETC:STAT?");
+    scpiService();
+    TEST_ASSERT_TRUE(scpiFetchPending());
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+
+    set_mock_millis(301);
+    scpiService();
+    TEST_ASSERT_FALSE(scpiFetchPending());
     TEST_ASSERT_EQUAL(1, errorQueue.count);
 }
 
+void test_fetc_stat_rejected_while_pending()
+{
+    scpiDispatch("FETC:STAT?");
+    scpiDispatch("FETC:STAT?"); // second poll before the reply arrived
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+    set_mock_millis(301);
+    scpiService(); // clean up the pending fetch for later tests
+}
+
 // ── CONF:SPKR ─────────────────────────────────────────────────────────────────
 
 void test_conf_spkr_sends_u_command()
@@ -458,6 +644,7 @@ void test_fetc_stat_restores_stream_mode()
     gmState.stream_mode = 1;
     Serial1.setInput("10,9,10,0,50,500,\n");
     scpiDispatch("FETC:STAT?");
+    scpiService();
     // lines[0] = "b2", lines[1] = "b1" (restore)
     TEST_ASSERT_TRUE((int)Serial1.lines.size() >= 2);
     TEST_ASSERT_EQUAL_STRING("b2", Serial1.lines[0].c_str());
@@ -477,15 +664,437 @@ void test_syst_vers_returns_scpi_version()
 
 void test_diag_stat_returns_acq_stats()
 {
-    // Format: dur_ms,npoints,debounced,overflows,tx_drops
+    // Format: dur_ms,npoints,debounced,overflows,tx_drops,min,max,mean,
+    //         variance,sub_dead,near_dead
     acqStats.startMs = 0;
     acqStats.endMs = 5000;
     acqStats.nPoints = 200;
     acqStats.debounced = 3;
     acqStats.overflows = 1;
     acqStats.txDrops = 0;
+    acqStats.minDelta = 480;
+    acqStats.maxDelta = 960;
+    acqStats.meanDelta = 720.0;
+    acqStats.m2 = 199 * 2.5; // sample variance = m2 / (n - 1) = 2.5
+    acqStats.subDead = 4;
+    acqStats.nearDead = 17;
     scpiDispatch("DIAG:STAT?");
-    TEST_ASSERT_EQUAL_STRING("5000,200,3,1,0", Serial.lastLine().c_str());
+    TEST_ASSERT_EQUAL_STRING("5000,200,3,1,0,480,960,720.0,2.5,4,17",
+                             Serial.lastLine().c_str());
+}
+
+// ── CONF:STATS ────────────────────────────────────────────────────────────────
+
+void test_conf_stats_set_and_query()
+{
+    scpiDispatch("CONF:STATS ON");
+    TEST_ASSERT_TRUE(gmState.stats_sideband);
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+    // Arduino-local setting — nothing may be sent to the GM counter hardware.
+    TEST_ASSERT_EQUAL(0, (int)Serial1.lines.size());
+    scpiDispatch("CONF:STATS?");
+    TEST_ASSERT_EQUAL_STRING("1", Serial.lastLine().c_str());
+    scpiDispatch("CONF:STATS OFF");
+    TEST_ASSERT_FALSE(gmState.stats_sideband);
+}
+
+void test_conf_stats_invalid_param_pushes_error()
+{
+    scpiDispatch("CONF:STATS MAYBE");
+    TEST_ASSERT_FALSE(gmState.stats_sideband);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
+void test_conf_stats_varint_conflict_both_directions()
+{
+    scpiDispatch("CONF:ENC VARINT");
+    scpiDispatch("CONF:STATS ON"); // 0xAB frames would garble a varint stream
+    TEST_ASSERT_FALSE(gmState.stats_sideband);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+
+    scpiDispatch("CONF:ENC FIXED");
+    scpiDispatch("CONF:STATS ON");
+    scpiDispatch("CONF:ENC VARINT"); // same conflict, other direction
+    TEST_ASSERT_EQUAL(ENC_FIXED, gmState.encoding);
+    TEST_ASSERT_EQUAL(2, errorQueue.count);
+    scpiDispatch("CONF:STATS OFF");
+}
+
+// ── CONF:SYNC / SYST:SYNC? ───────────────────────────────────────────────────
+
+void test_conf_sync_set_and_query()
+{
+    scpiDispatch("CONF:SYNC ON");
+    TEST_ASSERT_TRUE(gmState.sync_epoch);
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+    // Arduino-local setting — nothing may be sent to the GM counter hardware.
+    TEST_ASSERT_EQUAL(0, (int)Serial1.lines.size());
+    scpiDispatch("CONF:SYNC?");
+    TEST_ASSERT_EQUAL_STRING("1", Serial.lastLine().c_str());
+    scpiDispatch("CONF:SYNC OFF");
+    TEST_ASSERT_FALSE(gmState.sync_epoch);
+}
+
+void test_conf_trail_set_and_query()
+{
+    TEST_ASSERT_FALSE(gmState.session_trailer); // off by default
+    scpiDispatch("CONF:TRAIL ON");
+    TEST_ASSERT_TRUE(gmState.session_trailer);
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+    // Arduino-local setting — nothing may be sent to the GM counter hardware.
+    TEST_ASSERT_EQUAL(0, (int)Serial1.lines.size());
+    scpiDispatch("CONF:TRAIL?");
+    TEST_ASSERT_EQUAL_STRING("1", Serial.lastLine().c_str());
+    scpiDispatch("CONFIGURE:TRAILER OFF");
+    TEST_ASSERT_FALSE(gmState.session_trailer);
+}
+
+void test_syst_sync_returns_clock_pair()
+{
+    set_mock_micros(5000);
+    set_mock_millis(42);
+    scpiDispatch("SYST:SYNC?");
+    TEST_ASSERT_EQUAL_STRING("5000,42", Serial.lastLine().c_str());
+}
+
+// ── CONF:ACQ RNG ─────────────────────────────────────────────────────────────
+
+void test_conf_acq_rng_selects_mode_and_debiaser()
+{
+    scpiDispatch("CONF:ACQ RNG,PAR");
+    TEST_ASSERT_EQUAL(ACQ_RNG, gmState.acq_mode);
+    TEST_ASSERT_EQUAL(RNG_PARITY, gmRngMethod());
+    scpiDispatch("CONF:ACQ?");
+    TEST_ASSERT_EQUAL_STRING("4", Serial.lastLine().c_str());
+    scpiDispatch("CONF:ACQ RNG,VN");
+    TEST_ASSERT_EQUAL(RNG_VN, gmRngMethod());
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+}
+
+void test_conf_acq_rng_unknown_debiaser_pushes_error()
+{
+    scpiDispatch("CONF:ACQ RNG,XOR");
+    TEST_ASSERT_EQUAL(ACQ_STREAM, gmState.acq_mode); // unchanged
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
+// ── CONF:CH2 ─────────────────────────────────────────────────────────────────
+
+void test_conf_ch2_set_and_query()
+{
+    scpiDispatch("CONF:CH2?");
+    TEST_ASSERT_EQUAL_STRING("0", Serial.lastLine().c_str());
+    scpiDispatch("CONF:CH2 ON");
+    TEST_ASSERT_TRUE(gmState.ch2_enabled);
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+    // Arduino-local setting — nothing may be sent to the GM counter hardware.
+    TEST_ASSERT_EQUAL(0, (int)Serial1.lines.size());
+    scpiDispatch("CONF:CH2?");
+    TEST_ASSERT_EQUAL_STRING("1", Serial.lastLine().c_str());
+    scpiDispatch("CONF:CH2 OFF");
+    TEST_ASSERT_FALSE(gmState.ch2_enabled);
+}
+
+void test_conf_ch2_rejected_outside_fixed_stream()
+{
+    scpiDispatch("CONF:ENC VARINT");
+    scpiDispatch("CONF:CH2 ON"); // no channel tag in the varint stream
+    TEST_ASSERT_FALSE(gmState.ch2_enabled);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+
+    errorQueue.clear();
+    scpiDispatch("CONF:ENC FIXED");
+    scpiDispatch("CONF:ACQ HIST");
+    scpiDispatch("CONF:CH2 ON"); // histogram frames carry no channel field
+    TEST_ASSERT_FALSE(gmState.ch2_enabled);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
+void test_conf_ch2_blocks_leaving_fixed_stream()
+{
+    scpiDispatch("CONF:CH2 ON");
+    TEST_ASSERT_TRUE(gmState.ch2_enabled);
+
+    scpiDispatch("CONF:ENC VARINT"); // 0xA9 frames would corrupt the stream
+    TEST_ASSERT_EQUAL(ENC_FIXED, gmState.encoding);
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+
+    scpiDispatch("CONF:ACQ HIST"); // and the channel only exists in STREAM
+    TEST_ASSERT_EQUAL(ACQ_STREAM, gmState.acq_mode);
+    TEST_ASSERT_EQUAL(2, errorQueue.count);
+
+    scpiDispatch("CONF:CH2 OFF");
+    scpiDispatch("CONF:ACQ HIST"); // allowed again once CH2 is off
+    TEST_ASSERT_EQUAL(ACQ_HIST, gmState.acq_mode);
+    TEST_ASSERT_EQUAL(2, errorQueue.count);
+    scpiDispatch("CONF:ACQ STREAM");
+}
+
+// ── CONF:DEAD ────────────────────────────────────────────────────────────────
+
+void test_conf_dead_set_and_query()
+{
+    scpiDispatch("CONF:DEAD?");
+    TEST_ASSERT_EQUAL_STRING("200", Serial.lastLine().c_str()); // default
+    scpiDispatch("CONF:DEAD 120");
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+    // Arduino-local setting — nothing may be sent to the GM counter hardware.
+    TEST_ASSERT_EQUAL(0, (int)Serial1.lines.size());
+    scpiDispatch("CONF:DEAD?");
+    TEST_ASSERT_EQUAL_STRING("120", Serial.lastLine().c_str());
+    scpiDispatch("CONF:DEAD 200"); // restore the default for later tests
+}
+
+void test_conf_dead_out_of_range_pushes_error()
+{
+    scpiDispatch("CONF:DEAD 0");
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+    scpiDispatch("CONF:DEAD 200000"); // above DEADTIME_MAX_US
+    TEST_ASSERT_EQUAL(2, errorQueue.count);
+    scpiDispatch("CONF:DEAD?");
+    TEST_ASSERT_EQUAL_STRING("200", Serial.lastLine().c_str()); // unchanged
+}
+
+// ── CONF:WMARK ───────────────────────────────────────────────────────────────
+
+void test_conf_wmark_set_and_query()
+{
+    scpiDispatch("CONF:WMARK?");
+    TEST_ASSERT_EQUAL_STRING("0", Serial.lastLine().c_str()); // default: off
+    scpiDispatch("CONF:WMARK 512");
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+    // Arduino-local setting — nothing may be sent to the GM counter hardware.
+    TEST_ASSERT_EQUAL(0, (int)Serial1.lines.size());
+    scpiDispatch("CONF:WMARK?");
+    TEST_ASSERT_EQUAL_STRING("512", Serial.lastLine().c_str());
+    scpiDispatch("CONF:WMARK 0"); // restore the default for later tests
+}
+
+void test_conf_wmark_out_of_range_pushes_error()
+{
+    scpiDispatch("CONF:WMARK 1024"); // ring holds at most RING_BUF_SIZE-1
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+    scpiDispatch("CONF:WMARK?");
+    TEST_ASSERT_EQUAL_STRING("0", Serial.lastLine().c_str()); // unchanged
+}
+
+// ── Serial1 hardware-state cache / INIT:FAST ─────────────────────────────────
+
+void test_serial1_cache_elides_repeated_writes()
+{
+    scpiDispatch("CONF:VOLT 500");
+    TEST_ASSERT_EQUAL(1, (int)Serial1.lines.size());
+    TEST_ASSERT_EQUAL_STRING("j500", Serial1.lastLine().c_str());
+    scpiDispatch("CONF:VOLT 500"); // unchanged — elided
+    TEST_ASSERT_EQUAL(1, (int)Serial1.lines.size());
+    scpiDispatch("CONF:VOLT 520"); // changed — written
+    TEST_ASSERT_EQUAL(2, (int)Serial1.lines.size());
+    TEST_ASSERT_EQUAL_STRING("j520", Serial1.lastLine().c_str());
+}
+
+void test_stream_mode_trigger_never_cached()
+{
+    // b2/b3 are one-shot send triggers on the GM counter (not level state),
+    // so 'b' writes must never be elided: a repeated CONF:STR re-triggers a
+    // send, and FETC:STAT?'s own b2 request always reaches the hardware.
+    scpiDispatch("CONF:STR 2");
+    scpiDispatch("CONF:STR 2"); // same value — still written
+    TEST_ASSERT_EQUAL(2, (int)Serial1.lines.size());
+    TEST_ASSERT_EQUAL_STRING("b2", Serial1.lines[1].c_str());
+
+    Serial1.clear();
+    Serial1.setInput("100,90,10,0,50,500,\n");
+    scpiDispatch("FETC:STAT?");
+    TEST_ASSERT_EQUAL_STRING("b2", Serial1.lines[0].c_str());
+    scpiService(); // deliver the reply so later tests start clean
+    TEST_ASSERT_FALSE(scpiFetchPending());
+}
+
+void test_rst_reapplies_despite_cache()
+{
+    scpiDispatch("CONF:VOLT 500"); // cache now holds the default value
+    Serial1.clear();
+    scpiDispatch("*RST"); // must really write — recovery command
+    TEST_ASSERT_EQUAL(4, (int)Serial1.lines.size());
+    TEST_ASSERT_EQUAL_STRING("j500", Serial1.lines[0].c_str());
+}
+
+void test_init_fast_sends_only_s1()
+{
+    scpiDispatch("*RST"); // primes all three cached letters
+    Serial1.clear();
+    scpiDispatch("INIT:FAST");
+    TEST_ASSERT_TRUE(gmState.streaming);
+    TEST_ASSERT_TRUE(gmState.endPeriodArmed); // finite default time mode
+    TEST_ASSERT_EQUAL(1, (int)Serial1.lines.size());
+    TEST_ASSERT_EQUAL_STRING("s1", Serial1.lastLine().c_str());
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+}
+
+void test_init_fast_without_prior_config_pushes_error()
+{
+    scpiDispatch("INIT:FAST"); // cache empty — nothing ever written
+    TEST_ASSERT_FALSE(gmState.streaming);
+    TEST_ASSERT_EQUAL(0, (int)Serial1.lines.size());
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
+// ── Serial1 TX queue / SYST:BAUD ─────────────────────────────────────────────
+
+void test_s1tx_queue_holds_lines_until_uart_has_room()
+{
+    Serial1.txSpace = 0; // UART reports no room — nothing may be written
+    scpiDispatch("CONF:VOLT 520");
+    TEST_ASSERT_EQUAL(520, gmState.voltage); // state applied immediately
+    TEST_ASSERT_EQUAL(0, (int)Serial1.lines.size());
+
+    Serial1.txSpace = 4096;
+    scpiSerial1Service(); // what loop() does once the UART drains
+    TEST_ASSERT_EQUAL(1, (int)Serial1.lines.size());
+    TEST_ASSERT_EQUAL_STRING("j520", Serial1.lastLine().c_str());
+}
+
+void test_s1tx_queue_preserves_fifo_order()
+{
+    Serial1.txSpace = 0;
+    scpiDispatch("CONF:VOLT 520");
+    scpiDispatch("CONF:TIME 3");
+    TEST_ASSERT_EQUAL(0, (int)Serial1.lines.size());
+
+    Serial1.txSpace = 4096;
+    scpiSerial1Service();
+    TEST_ASSERT_EQUAL(2, (int)Serial1.lines.size());
+    TEST_ASSERT_EQUAL_STRING("j520", Serial1.lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("f3", Serial1.lines[1].c_str());
+}
+
+void test_s1tx_queue_full_forces_oldest_not_drops()
+{
+    Serial1.txSpace = 0;
+    char line[8];
+    for (int i = 0; i < S1TX_QUEUE_SIZE + 1; i++)
+    {
+        snprintf(line, sizeof(line), "j%d", 300 + 2 * i);
+        scpiSerial1Enqueue(line);
+    }
+    // The overflowing enqueue forced the oldest line out synchronously.
+    TEST_ASSERT_EQUAL(1, (int)Serial1.lines.size());
+    TEST_ASSERT_EQUAL_STRING("j300", Serial1.lines[0].c_str());
+
+    Serial1.txSpace = 4096;
+    scpiSerial1Service();
+    TEST_ASSERT_EQUAL(S1TX_QUEUE_SIZE + 1, (int)Serial1.lines.size());
+    TEST_ASSERT_EQUAL_STRING("j302", Serial1.lines[1].c_str()); // order kept
+}
+
+void test_syst_baud_set_and_query()
+{
+    scpiDispatch("SYST:BAUD?");
+    TEST_ASSERT_EQUAL_STRING("9600", Serial.lastLine().c_str()); // default
+    scpiDispatch("SYST:BAUD 115200");
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+    scpiDispatch("SYST:BAUD?");
+    TEST_ASSERT_EQUAL_STRING("115200", Serial.lastLine().c_str());
+    scpiDispatch("SYST:BAUD 9600"); // restore for later tests
+}
+
+void test_syst_baud_invalid_rate_pushes_error()
+{
+    scpiDispatch("SYST:BAUD 12345");
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+    scpiDispatch("SYST:BAUD?");
+    TEST_ASSERT_EQUAL_STRING("9600", Serial.lastLine().c_str()); // unchanged
+}
+
+// ── Binary fast path ─────────────────────────────────────────────────────────
+
+void test_fast_opcode_init_and_abort()
+{
+    TEST_ASSERT_TRUE(scpiFastByte(OP_INIT));
+    TEST_ASSERT_TRUE(gmState.streaming);
+    TEST_ASSERT_TRUE(scpiFastByte(OP_ABOR));
+    TEST_ASSERT_FALSE(gmState.streaming);
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+}
+
+void test_fast_opcode_volt_two_byte_sequence()
+{
+    TEST_ASSERT_TRUE(scpiFastByte(OP_VOLT));
+    TEST_ASSERT_TRUE(scpiFastByte(100)); // 300 + 2·100 = 500 V
+    TEST_ASSERT_EQUAL(500, gmState.voltage);
+    TEST_ASSERT_EQUAL_STRING("j500", Serial1.lastLine().c_str());
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+}
+
+void test_fast_opcode_unknown_byte_not_consumed()
+{
+    TEST_ASSERT_FALSE(scpiFastByte((uint8_t)'C'));
+    TEST_ASSERT_FALSE(scpiFastByte(0x90));
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
+}
+
+void test_fast_opcode_init_rejected_while_streaming()
+{
+    scpiFastByte(OP_INIT);
+    TEST_ASSERT_TRUE(scpiFastByte(OP_INIT)); // consumed, but rejected
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+    TEST_ASSERT_TRUE(gmState.streaming);
+}
+
+// ── DIAG:SELFTEST? ───────────────────────────────────────────────────────────
+// The sweep itself paces on real time (see test_gm_core for the sweep logic);
+// only the guard paths are reachable under the mocked clock.
+
+void test_diag_selftest_rejected_while_streaming()
+{
+    gmState.streaming = true;
+    scpiDispatch("DIAG:SELFTEST?");
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
+void test_diag_selftest_command_form_pushes_error()
+{
+    scpiDispatch("DIAG:SELFTEST");
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
+// ── DIAG:PROF? ────────────────────────────────────────────────────────────────
+
+void test_diag_prof_returns_profile_csv()
+{
+    // Fresh profile: 3 summary fields + PROF_BINS zero counts.
+    scpiDispatch("DIAG:PROF?");
+    std::string resp = Serial.lastLine();
+    int commas = 0;
+    for (char c : resp)
+        if (c == ',')
+            commas++;
+    TEST_ASSERT_EQUAL(2 + PROF_BINS, commas);
+    TEST_ASSERT_TRUE(resp.rfind("0,0,0", 0) == 0);
+}
+
+void test_diag_prof_command_form_pushes_error()
+{
+    scpiDispatch("DIAG:PROF");
+    TEST_ASSERT_EQUAL(1, errorQueue.count);
+}
+
+// ── Dispatch table ────────────────────────────────────────────────────────────
+
+void test_command_table_is_sorted()
+{
+    // bsearch() requires strict strcmp order — catch a misplaced entry at once.
+    for (size_t i = 1; i < _numCommands; i++)
+        TEST_ASSERT_TRUE(strcmp(_commands[i - 1].header, _commands[i].header) < 0);
+}
+
+void test_long_form_headers_dispatch()
+{
+    scpiDispatch("CONFIGURE:VOLTAGE 600");
+    TEST_ASSERT_EQUAL(600, gmState.voltage);
+    scpiDispatch("SYSTEM:VERSION?");
+    TEST_ASSERT_EQUAL_STRING("1999.0", Serial.lastLine().c_str());
+    TEST_ASSERT_EQUAL(0, errorQueue.count);
 }
 
 // ── Streaming rejection ───────────────────────────────────────────────────────
@@ -495,18 +1104,19 @@ void test_streaming_non_abor_pushes_error()
     gmState.streaming = true;
     // A CONF command during streaming must push -213.
     // Simulate the streaming-path logic from main.cpp directly.
-    String h, p;
+    char h[SCPI_MAX_HEADER], p[SCPI_MAX_PARAM];
     bool q;
-    String cmd = "CONF:VOLT 500";
+    const char *cmd = "CONF:VOLT 500";
     if (scpiParse(cmd, h, p, q))
     {
-        if (!q && (h == "ABOR" || h == "ABORT" || h == "*RST"))
+        if (!q && (strcmp(h, "ABOR") == 0 || strcmp(h, "ABORT") == 0 ||
+                   strcmp(h, "*RST") == 0))
             scpiDispatch(cmd);
         else
             errorQueue.push("-213,\"Init ignored; streaming is active\"");
     }
     TEST_ASSERT_EQUAL(1, errorQueue.count);
-    TEST_ASSERT_TRUE(String(errorQueue.pop().c_str()).startsWith("-213,"));
+    TEST_ASSERT_TRUE(String(errorQueue.pop()).startsWith("-213,"));
 }
 
 int main()
@@ -543,7 +1153,8 @@ int main()
     // End-of-period arming (e1)
     RUN_TEST(test_init_finite_time_arms_eop);
     RUN_TEST(test_init_infinite_time_does_not_arm_eop);
-    RUN_TEST(test_init_repeat_mode_does_not_arm_eop);
+    RUN_TEST(test_init_repeat_mode_arms_eop_too);
+    RUN_TEST(test_init_rejects_repeat_mode_under_varint);
     RUN_TEST(test_abor_sends_e0_and_disarms);
     RUN_TEST(test_rst_while_streaming_disarms_eop);
     // CONF:VOLT
@@ -565,10 +1176,29 @@ int main()
     // CONF:STR
     RUN_TEST(test_conf_str_set);
     RUN_TEST(test_conf_str_query);
+
+    RUN_TEST(test_conf_enc_set_varint);
+    RUN_TEST(test_conf_enc_set_seq);
+    RUN_TEST(test_conf_enc_query);
+    RUN_TEST(test_conf_enc_rejected_while_streaming);
+    RUN_TEST(test_conf_enc_invalid_param_pushes_error);
+
+    RUN_TEST(test_conf_acq_set_hist);
+    RUN_TEST(test_conf_acq_query);
+    RUN_TEST(test_conf_acq_rejected_while_streaming);
+    RUN_TEST(test_conf_acq_burst_with_count);
+    RUN_TEST(test_conf_acq_mcs_with_width);
+    RUN_TEST(test_conf_acq_mcs_invalid_width_pushes_error);
+    RUN_TEST(test_conf_acq_burst_invalid_count_pushes_error);
+    RUN_TEST(test_conf_hist_lin_sets_width);
+    RUN_TEST(test_conf_hist_invalid_width_pushes_error);
     // FETC:STAT?
     RUN_TEST(test_fetc_stat_sends_b2_to_hardware);
+    RUN_TEST(test_init_rejected_while_fetch_pending);
     RUN_TEST(test_fetc_stat_forwards_response);
     RUN_TEST(test_fetc_stat_no_response_pushes_error);
+    RUN_TEST(test_fetc_stat_does_not_block_before_timeout);
+    RUN_TEST(test_fetc_stat_rejected_while_pending);
     // CONF:SPKR
     RUN_TEST(test_conf_spkr_sends_u_command);
     RUN_TEST(test_conf_spkr_out_of_range_pushes_error);
@@ -583,7 +1213,47 @@ int main()
     RUN_TEST(test_syst_vers_returns_scpi_version);
     // DIAG:STAT?
     RUN_TEST(test_diag_stat_returns_acq_stats);
+    // CONF:STATS
+    RUN_TEST(test_conf_stats_set_and_query);
+    RUN_TEST(test_conf_stats_invalid_param_pushes_error);
+    RUN_TEST(test_conf_stats_varint_conflict_both_directions);
+    RUN_TEST(test_conf_sync_set_and_query);
+    RUN_TEST(test_conf_trail_set_and_query);
+    RUN_TEST(test_syst_sync_returns_clock_pair);
+    RUN_TEST(test_conf_acq_rng_selects_mode_and_debiaser);
+    RUN_TEST(test_conf_acq_rng_unknown_debiaser_pushes_error);
+    RUN_TEST(test_conf_ch2_set_and_query);
+    RUN_TEST(test_conf_ch2_rejected_outside_fixed_stream);
+    RUN_TEST(test_conf_ch2_blocks_leaving_fixed_stream);
+    RUN_TEST(test_conf_dead_set_and_query);
+    RUN_TEST(test_conf_dead_out_of_range_pushes_error);
+    RUN_TEST(test_conf_wmark_set_and_query);
+    RUN_TEST(test_conf_wmark_out_of_range_pushes_error);
+    // Serial1 cache / INIT:FAST
+    RUN_TEST(test_serial1_cache_elides_repeated_writes);
+    RUN_TEST(test_stream_mode_trigger_never_cached);
+    RUN_TEST(test_rst_reapplies_despite_cache);
+    RUN_TEST(test_init_fast_sends_only_s1);
+    RUN_TEST(test_init_fast_without_prior_config_pushes_error);
+    // Serial1 TX queue / SYST:BAUD
+    RUN_TEST(test_s1tx_queue_holds_lines_until_uart_has_room);
+    RUN_TEST(test_s1tx_queue_preserves_fifo_order);
+    RUN_TEST(test_s1tx_queue_full_forces_oldest_not_drops);
+    RUN_TEST(test_syst_baud_set_and_query);
+    RUN_TEST(test_syst_baud_invalid_rate_pushes_error);
+
+    RUN_TEST(test_fast_opcode_init_and_abort);
+    RUN_TEST(test_fast_opcode_volt_two_byte_sequence);
+    RUN_TEST(test_fast_opcode_unknown_byte_not_consumed);
+    RUN_TEST(test_fast_opcode_init_rejected_while_streaming);
+    // DIAG:SELFTEST?
+    RUN_TEST(test_diag_selftest_rejected_while_streaming);
+    RUN_TEST(test_diag_selftest_command_form_pushes_error);
+    RUN_TEST(test_diag_prof_returns_profile_csv);
+    RUN_TEST(test_diag_prof_command_form_pushes_error);
     // streaming rejection
+    RUN_TEST(test_command_table_is_sorted);
+    RUN_TEST(test_long_form_headers_dispatch);
     RUN_TEST(test_streaming_non_abor_pushes_error);
     return UNITY_END();
 }
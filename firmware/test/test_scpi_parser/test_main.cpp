@@ -14,85 +14,95 @@ void tearDown() {}
 
 void test_empty_string_returns_false()
 {
-    String h, p;
+    char h[SCPI_MAX_HEADER], p[SCPI_MAX_PARAM];
     bool q;
     TEST_ASSERT_FALSE(scpiParse("", h, p, q));
 }
 
 void test_simple_command_no_param()
 {
-    String h, p;
+    char h[SCPI_MAX_HEADER], p[SCPI_MAX_PARAM];
     bool q;
     TEST_ASSERT_TRUE(scpiParse("*RST", h, p, q));
-    TEST_ASSERT_EQUAL_STRING("*RST", h.c_str());
-    TEST_ASSERT_EQUAL_STRING("", p.c_str());
+    TEST_ASSERT_EQUAL_STRING("*RST", h);
+    TEST_ASSERT_EQUAL_STRING("", p);
     TEST_ASSERT_FALSE(q);
 }
 
 void test_query_strips_question_mark()
 {
-    String h, p;
+    char h[SCPI_MAX_HEADER], p[SCPI_MAX_PARAM];
     bool q;
     scpiParse("*IDN?", h, p, q);
-    TEST_ASSERT_EQUAL_STRING("*IDN", h.c_str());
+    TEST_ASSERT_EQUAL_STRING("*IDN", h);
     TEST_ASSERT_TRUE(q);
-    TEST_ASSERT_EQUAL_STRING("", p.c_str());
+    TEST_ASSERT_EQUAL_STRING("", p);
 }
 
 void test_command_with_parameter()
 {
-    String h, p;
+    char h[SCPI_MAX_HEADER], p[SCPI_MAX_PARAM];
     bool q;
     scpiParse("CONF:VOLT 500", h, p, q);
-    TEST_ASSERT_EQUAL_STRING("CONF:VOLT", h.c_str());
-    TEST_ASSERT_EQUAL_STRING("500", p.c_str());
+    TEST_ASSERT_EQUAL_STRING("CONF:VOLT", h);
+    TEST_ASSERT_EQUAL_STRING("500", p);
     TEST_ASSERT_FALSE(q);
 }
 
 void test_header_uppercased()
 {
-    String h, p;
+    char h[SCPI_MAX_HEADER], p[SCPI_MAX_PARAM];
     bool q;
     scpiParse("conf:volt 500", h, p, q);
-    TEST_ASSERT_EQUAL_STRING("CONF:VOLT", h.c_str());
+    TEST_ASSERT_EQUAL_STRING("CONF:VOLT", h);
 }
 
 void test_param_uppercased_and_trimmed()
 {
-    String h, p;
+    char h[SCPI_MAX_HEADER], p[SCPI_MAX_PARAM];
     bool q;
     scpiParse("CONF:REP  on ", h, p, q);
-    TEST_ASSERT_EQUAL_STRING("ON", p.c_str());
+    TEST_ASSERT_EQUAL_STRING("ON", p);
 }
 
 void test_query_with_no_param()
 {
-    String h, p;
+    char h[SCPI_MAX_HEADER], p[SCPI_MAX_PARAM];
     bool q;
     scpiParse("CONF:VOLT?", h, p, q);
-    TEST_ASSERT_EQUAL_STRING("CONF:VOLT", h.c_str());
-    TEST_ASSERT_EQUAL_STRING("", p.c_str());
+    TEST_ASSERT_EQUAL_STRING("CONF:VOLT", h);
+    TEST_ASSERT_EQUAL_STRING("", p);
     TEST_ASSERT_TRUE(q);
 }
 
 void test_common_command_cls()
 {
-    String h, p;
+    char h[SCPI_MAX_HEADER], p[SCPI_MAX_PARAM];
     bool q;
     scpiParse("*CLS", h, p, q);
-    TEST_ASSERT_EQUAL_STRING("*CLS", h.c_str());
+    TEST_ASSERT_EQUAL_STRING("*CLS", h);
     TEST_ASSERT_FALSE(q);
 }
 
 void test_multi_word_header_preserved()
 {
-    String h, p;
+    char h[SCPI_MAX_HEADER], p[SCPI_MAX_PARAM];
     bool q;
     scpiParse("SYST:ERR?", h, p, q);
-    TEST_ASSERT_EQUAL_STRING("SYST:ERR", h.c_str());
+    TEST_ASSERT_EQUAL_STRING("SYST:ERR", h);
     TEST_ASSERT_TRUE(q);
 }
 
+void test_overlong_header_truncated_not_overflowed()
+{
+    char h[SCPI_MAX_HEADER], p[SCPI_MAX_PARAM];
+    bool q;
+    // Longer than SCPI_MAX_HEADER — must be truncated, never overrun.
+    scpiParse("THIS:IS:A:VERY:LONG:UNDEFINED:HEADER:FORM 1", h, p, q);
+    TEST_ASSERT_EQUAL(SCPI_MAX_HEADER - 1, (int)strlen(h));
+    TEST_ASSERT_EQUAL_STRING("1", p);
+}
+
 int main()
 {
     UNITY_BEGIN();
@@ -105,5 +115,6 @@ int main()
     RUN_TEST(test_query_with_no_param);
     RUN_TEST(test_common_command_cls);
     RUN_TEST(test_multi_word_header_preserved);
+    RUN_TEST(test_overlong_header_truncated_not_overflowed);
     return UNITY_END();
 }